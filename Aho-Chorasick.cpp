@@ -13,6 +13,37 @@
 #include <condition_variable>   // 조건 변수 사용
 #include <functional>           // std::function 사용
 #include <filesystem>           // 파일 시스템 사용
+#include <future>               // 스레드 기반 비동기 읽기에 사용
+#include <deque>                // 진행 중인 읽기 요청 보관
+#include <map>                  // 프로파일 단계별 집계에 사용
+#include <unordered_map>        // 패널의 패턴 → 인덱스 조회
+#include <cstring>              // memset 사용
+#include <cerrno>               // errno 사용
+#include <cstdint>              // uint64_t 사용
+#include <sstream>              // 캐시 키 생성에 사용
+#include <memory>               // std::unique_ptr 사용
+#include <tuple>                // k-mer 매칭 (패턴, 오차 수, 위치) 보관
+#include <stdexcept>            // std::length_error 사용
+
+#include <fcntl.h>              // open 사용
+#include <unistd.h>             // pread, close 사용
+#include <sys/stat.h>           // fstat 사용
+#include <sys/mman.h>           // io_uring 링 매핑에 사용
+#include <sys/syscall.h>        // io_uring 시스템 콜 사용
+#include <sys/file.h>           // 캐시 디렉토리 잠금(flock)에 사용
+#include <sys/socket.h>         // 쿼리 서버 소켓 사용
+#include <sys/un.h>             // Unix 도메인 소켓 주소
+#include <linux/perf_event.h>   // 하드웨어 카운터(perf_event_open) 사용
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>     // io_uring 구조체 및 상수
+#define AHO_HAVE_IO_URING 1
+#endif
+
+#if __has_include(<zlib.h>)
+#include <zlib.h>               // gzip/BGZF 입력 압축 해제 (-lz)
+#define AHO_HAVE_ZLIB 1
+#endif
 
 #include "random_generator/DnaGenerator.h"       // DnaGenerator.h 헤더 파일 포함
 
@@ -25,10 +56,350 @@ std::mutex queue_mutex;  // 작업 큐 동기화를 위한 뮤텍스
 
 // 진행률 계산을 위한 원자적 변수
 std::atomic<long long> total_processed(0); // 처리된 작업 수를 원자적으로 추적
-long long total_work = 0; // 전체 작업량 (패턴 수 × 텍스트 길이)
+std::atomic<long long> total_work(0); // 전체 작업량 (패턴 수 × 텍스트 길이), 레코드가 도착할 때마다 증가
+
+// 큰 검색 테이블을 투명 huge page로 할당할지 여부 (--huge-pages, 프로그램 시작 시에만 변경)
+bool useHugePages = false;
+
+/*
+    SNP 위치 비트맵
+    여러 레코드의 검색이 워커 풀에서 동시에 진행되므로 64비트 원자 워드 단위로 비트를 설정한다.
+    고정 크기 세그먼트를 필요할 때마다 할당하고 이미 할당된 세그먼트는 옮기지 않으므로,
+    검색 중인 워커가 있어도 extend로 길이를 늘릴 수 있다. (extend는 한 스레드에서만 호출)
+    extend는 새 세그먼트를 만든 뒤 길이를 release로 저장하고 size()는 acquire로 읽으므로,
+    size()로 범위를 확인한 워커는 그 범위의 세그먼트를 항상 볼 수 있다.
+*/
+class SnpBitmap {
+public:
+    static const int SEGMENT_WORDS_LOG = 20;                      // 세그먼트당 2^20 워드 (2^26 비트, 8 MiB)
+    static const long long SEGMENT_WORDS = 1LL << SEGMENT_WORDS_LOG;
+    static const long long MAX_SEGMENTS = 1LL << 16;              // 최대 2^42 비트
+    static const long long MAX_LENGTH = MAX_SEGMENTS * SEGMENT_WORDS * 64;
+
+    SnpBitmap() : segments(new std::unique_ptr<std::atomic<uint64_t>[]>[MAX_SEGMENTS]) {}
+
+    long long size() const { return length.load(std::memory_order_acquire); }
+
+    // 비트맵 길이를 newLength로 늘림 (새 비트는 0, MAX_LENGTH를 넘으면 std::length_error)
+    void extend(long long newLength) {
+        if (newLength > MAX_LENGTH) {
+            throw std::length_error("SNP 비트맵 최대 길이 초과");
+        }
+        long long neededSegments = (newLength + SEGMENT_WORDS * 64 - 1) / (SEGMENT_WORDS * 64);
+        long long allocated = allocatedSegments.load(std::memory_order_relaxed);
+        for (long long s = allocated; s < neededSegments; ++s) {
+            segments[s].reset(new std::atomic<uint64_t>[SEGMENT_WORDS]());
+        }
+        allocatedSegments.store(std::max(allocated, neededSegments), std::memory_order_release);
+        if (newLength > length.load(std::memory_order_relaxed)) {
+            length.store(newLength, std::memory_order_release);
+        }
+    }
+
+    void set(long long pos) {
+        word(pos >> 6).fetch_or(1ULL << (pos & 63), std::memory_order_relaxed);
+    }
+
+    void reset(long long pos) {
+        word(pos >> 6).fetch_and(~(1ULL << (pos & 63)), std::memory_order_relaxed);
+    }
+
+    bool test(long long pos) const {
+        return (word(pos >> 6).load(std::memory_order_relaxed) >> (pos & 63)) & 1;
+    }
+
+    // 설정된 비트의 개수
+    long long count() const {
+        long long total = 0;
+        for (long long w = 0; w < numWords(); ++w) {
+            total += __builtin_popcountll(word(w).load(std::memory_order_relaxed));
+        }
+        return total;
+    }
+
+    long long numWords() const { return (size() + 63) / 64; }
+
+    std::atomic<uint64_t>& word(long long w) const {
+        return segments[w >> SEGMENT_WORDS_LOG][w & (SEGMENT_WORDS - 1)];
+    }
+
+private:
+    std::unique_ptr<std::unique_ptr<std::atomic<uint64_t>[]>[]> segments;
+    std::atomic<long long> allocatedSegments{0};   // extend에서만 쓰고, 다른 스레드는 length를 통해 동기화
+    std::atomic<long long> length{0};
+};
 
 // SNP 위치의 전체 집합을 저장하기 위한 전역 변수 추가
-std::vector<bool> globalSnpPositions; // 각 위치의 SNP 여부를 비트로 저장
+SnpBitmap globalSnpPositions; // 각 위치의 SNP 여부를 비트로 저장
+
+/*
+    단계별 프로파일러
+    ScopedPhase로 측정한 구간(단계 및 워커 작업)을 모아 JSON 요약과 Chrome trace 파일로 저장한다.
+    각 구간은 perf_event_open으로 하드웨어 카운터(사이클, 명령어, LLC 미스, 분기 예측 실패)도 측정하며,
+    카운터를 열 수 없는 환경(가상 머신, perf_event_paranoid 등)에서는 시간만 기록
+*/
+class Profiler {
+public:
+    static const int NUM_COUNTERS = 4;
+
+    struct Span {
+        std::string name;       // 구간 이름
+        std::string category;   // "phase" 또는 "task"
+        std::string detail;     // 부가 정보 (레코드 이름 등)
+        std::string record;     // 검색 작업 구간이 속한 레코드 (레코드별 합계에 사용)
+        int threadId;
+        long long startUs;      // 프로파일러 시작 이후 시각 (마이크로초)
+        long long durationUs;
+        std::array<long long, NUM_COUNTERS> counters; // 측정하지 못한 카운터는 -1
+    };
+
+    // --profile 옵션이 주어졌을 때 프로파일링 시작
+    void enable(const std::string& prefix) {
+        outputPrefix = prefix;
+        origin = std::chrono::steady_clock::now();
+        enabled = true;
+    }
+
+    bool isEnabled() const { return enabled; }
+
+    long long nowUs() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count();
+    }
+
+    // 호출한 스레드의 작은 정수 ID (trace의 tid로 사용)
+    static int threadId() {
+        static std::atomic<int> nextId(0);
+        thread_local int id = nextId++;
+        return id;
+    }
+
+    void record(Span span) {
+        std::lock_guard<std::mutex> lock(spanMutex);
+        spans.push_back(std::move(span));
+    }
+
+    // 요약(PREFIX.json)과 Chrome trace(PREFIX.trace.json) 파일 저장
+    void writeReports() {
+        if (!enabled) return;
+        std::lock_guard<std::mutex> lock(spanMutex);
+        writeSummary(outputPrefix + ".json");
+        writeTrace(outputPrefix + ".trace.json");
+        std::cout << "프로파일 결과를 '" << outputPrefix << ".json', '" << outputPrefix
+                  << ".trace.json'에 저장했습니다." << std::endl;
+    }
+
+    // 카운터 이름 (JSON 키)
+    static const char* counterName(int i) {
+        static const char* names[NUM_COUNTERS] = {"cycles", "instructions", "llc_misses", "branch_misses"};
+        return names[i];
+    }
+
+private:
+    bool enabled = false;
+    std::string outputPrefix;
+    std::chrono::steady_clock::time_point origin;
+    std::mutex spanMutex;
+    std::vector<Span> spans;
+
+    static std::string escapeJson(const std::string& value) {
+        std::string escaped;
+        for (char c : value) {
+            if (c == '"' || c == '\\') escaped += '\\';
+            if (static_cast<unsigned char>(c) < 0x20) continue;
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    struct Total {
+        long long count = 0;
+        long long durationUs = 0;
+        std::array<long long, NUM_COUNTERS> counters = {0, 0, 0, 0};
+        std::array<bool, NUM_COUNTERS> measured = {false, false, false, false};
+
+        void add(const Span& span) {
+            count++;
+            durationUs += span.durationUs;
+            for (int i = 0; i < NUM_COUNTERS; ++i) {
+                if (span.counters[i] < 0) continue;
+                counters[i] += span.counters[i];
+                measured[i] = true;
+            }
+        }
+    };
+
+    // 이름별 합계를 JSON 객체로 출력 (횟수, 총 시간, 카운터 합계와 IPC, 명령어 1000개당 LLC 미스)
+    static void writeTotals(std::ostream& out, const std::map<std::string, Total>& totals) {
+        out << "{";
+        bool first = true;
+        for (const auto& entry : totals) {
+            const Total& total = entry.second;
+            out << (first ? "\n" : ",\n") << "    \"" << escapeJson(entry.first) << "\": {"
+                << "\"count\": " << total.count << ", \"total_ms\": " << total.durationUs / 1000.0;
+            for (int i = 0; i < NUM_COUNTERS; ++i) {
+                out << ", \"" << counterName(i) << "\": ";
+                if (total.measured[i]) out << total.counters[i]; else out << "null";
+            }
+            if (total.measured[0] && total.measured[1] && total.counters[0] > 0) {
+                out << ", \"ipc\": " << static_cast<double>(total.counters[1]) / total.counters[0];
+            }
+            if (total.measured[1] && total.measured[2] && total.counters[1] > 0) {
+                out << ", \"llc_mpki\": " << total.counters[2] * 1000.0 / total.counters[1];
+            }
+            out << "}";
+            first = false;
+        }
+        out << "\n  }";
+    }
+
+    // 구간 이름별 합계와, 레코드별 검색 작업(scan_task, kmer_task)의 합계를 저장
+    // scan_wait는 메인 스레드가 기다린 시간만 측정하므로, 검색 자체의 카운터는 scan_records에 있음
+    void writeSummary(const std::string& fileName) {
+        std::map<std::string, Total> totals;
+        std::map<std::string, Total> recordTotals;
+        for (const Span& span : spans) {
+            totals[span.name].add(span);
+            if (span.category == "task" && !span.record.empty()) {
+                recordTotals[span.record].add(span);
+            }
+        }
+
+        std::ofstream out(fileName);
+        out << "{\n  \"phases\": ";
+        writeTotals(out, totals);
+        out << ",\n  \"scan_records\": ";
+        writeTotals(out, recordTotals);
+        out << ",\n  \"tasks\": " << std::count_if(spans.begin(), spans.end(),
+                                                    [](const Span& span) { return span.category == "task"; })
+            << "\n}\n";
+    }
+
+    // chrome://tracing 또는 Perfetto에서 열 수 있는 trace event 형식으로 저장
+    void writeTrace(const std::string& fileName) {
+        std::ofstream out(fileName);
+        out << "{\"traceEvents\": [";
+        for (size_t i = 0; i < spans.size(); ++i) {
+            const Span& span = spans[i];
+            out << (i == 0 ? "\n" : ",\n") << "{\"name\": \"" << escapeJson(span.name) << "\", \"cat\": \""
+                << span.category << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << span.threadId
+                << ", \"ts\": " << span.startUs << ", \"dur\": " << span.durationUs << ", \"args\": {";
+            bool firstArg = true;
+            if (!span.detail.empty()) {
+                out << "\"detail\": \"" << escapeJson(span.detail) << "\"";
+                firstArg = false;
+            }
+            for (int c = 0; c < NUM_COUNTERS; ++c) {
+                if (span.counters[c] < 0) continue;
+                out << (firstArg ? "" : ", ") << "\"" << counterName(c) << "\": " << span.counters[c];
+                firstArg = false;
+            }
+            out << "}}";
+        }
+        out << "\n], \"displayTimeUnit\": \"ms\"}\n";
+    }
+};
+
+Profiler profiler; // 전역 프로파일러 (--profile 옵션으로 활성화)
+
+/*
+    하드웨어 카운터 묶음 (사이클, 명령어, LLC 미스, 분기 예측 실패)
+    열 수 없는 카운터는 -1로 남으며, 읽으면 -1을 반환
+*/
+class CounterSet {
+public:
+    // inherit가 true이면 이후 생성되는 자식 스레드의 값도 (종료 시) 합산
+    explicit CounterSet(bool inherit) {
+        static const unsigned long long configs[Profiler::NUM_COUNTERS] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (int i = 0; i < Profiler::NUM_COUNTERS; ++i) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.inherit = inherit;
+            fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+    }
+
+    ~CounterSet() {
+        for (int fd : fds) {
+            if (fd >= 0) close(fd);
+        }
+    }
+
+    CounterSet(const CounterSet&) = delete;
+    CounterSet& operator=(const CounterSet&) = delete;
+
+    std::array<long long, Profiler::NUM_COUNTERS> read() const {
+        std::array<long long, Profiler::NUM_COUNTERS> values;
+        for (int i = 0; i < Profiler::NUM_COUNTERS; ++i) {
+            values[i] = -1;
+            if (fds[i] >= 0 && ::read(fds[i], &values[i], sizeof(values[i])) != sizeof(values[i])) values[i] = -1;
+        }
+        return values;
+    }
+
+private:
+    std::array<int, Profiler::NUM_COUNTERS> fds;
+};
+
+/*
+    구간의 시작과 끝을 측정하는 RAII 객체
+    "phase" 구간은 구간마다 inherit 옵션으로 카운터를 열어, 구간 안에서 생성되어 종료된 스레드의 값까지 합산한다.
+    "task" 구간은 워커 풀의 스레드처럼 오래 사는 스레드에서 쓰이므로, 스레드마다 한 번 열어 둔 카운터의
+    시작과 끝 값의 차이를 기록한다.
+    프로파일러가 꺼져 있으면 아무 일도 하지 않음
+*/
+class ScopedPhase {
+public:
+    explicit ScopedPhase(const char* name, const char* category = "phase", const std::string& detail = "",
+                         const std::string& record = "")
+        : active(profiler.isEnabled()) {
+        if (!active) return;
+        span.name = name;
+        span.category = category;
+        span.detail = detail;
+        span.record = record;
+        span.threadId = Profiler::threadId();
+        if (span.category == "phase") {
+            phaseCounters.reset(new CounterSet(true));
+        } else {
+            startCounters = threadCounters().read();
+        }
+        span.startUs = profiler.nowUs();
+    }
+
+    ~ScopedPhase() {
+        if (!active) return;
+        span.durationUs = profiler.nowUs() - span.startUs;
+        if (phaseCounters) {
+            span.counters = phaseCounters->read();
+        } else {
+            span.counters = threadCounters().read();
+            for (int i = 0; i < Profiler::NUM_COUNTERS; ++i) {
+                span.counters[i] = span.counters[i] < 0 ? -1 : span.counters[i] - startCounters[i];
+            }
+        }
+        profiler.record(std::move(span));
+    }
+
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+private:
+    bool active;
+    Profiler::Span span;
+    std::unique_ptr<CounterSet> phaseCounters;
+    std::array<long long, Profiler::NUM_COUNTERS> startCounters;
+
+    static CounterSet& threadCounters() {
+        thread_local CounterSet counters(false);
+        return counters;
+    }
+};
 
 /*
     문자를 인덱스로 반환하는 함수
@@ -45,6 +416,15 @@ int charToIndex(char c) {
     }
 }
 
+// 문자 → 인덱스 표 (charToIndex와 같은 매핑, 검색 루프에서 분기 없이 사용)
+const std::array<int8_t, 256> BASE_CODES = []() {
+    std::array<int8_t, 256> codes;
+    for (int c = 0; c < 256; ++c) {
+        codes[c] = charToIndex(static_cast<char>(c));
+    }
+    return codes;
+}();
+
 /* 
     Aho-Corasick 트라이 노드 구조체
     각 노드는 4개의 자식 노드를 가지며, A, T, C, G에 해당
@@ -53,9 +433,15 @@ int charToIndex(char c) {
 struct TrieNode {
     std::array<TrieNode*, 4> children; // A, T, C, G
     TrieNode* failure; // 실패 함수 포인터
-    std::vector<int> output; // 매칭된 패턴의 인덱스
+    std::vector<int> output; // 매칭된 패턴의 인덱스 (실패 노드의 출력 포함)
+
+    // 증분 갱신에 필요한 정보
+    TrieNode* parent; // 부모 노드
+    int depth; // 루트로부터의 깊이
+    std::vector<int> ownPatterns; // 이 노드에서 끝나는 패턴의 인덱스
+    std::vector<TrieNode*> failureChildren; // 이 노드를 실패 노드로 가지는 노드들
 
-    TrieNode() : failure(nullptr) {
+    TrieNode() : failure(nullptr), parent(nullptr), depth(0) {
         children.fill(nullptr);
     }
 };
@@ -75,10 +461,13 @@ void insertPattern(TrieNode* root, const std::string& pattern, int patternIndex)
         if (idx == -1) continue; // 유효하지 않은 문자 무시
         if (node->children[idx] == nullptr) {
             node->children[idx] = new TrieNode(); // 자식 노드가 없으면 새로 생성
+            node->children[idx]->parent = node;
+            node->children[idx]->depth = node->depth + 1;
         }
         node = node->children[idx]; // 다음 노드로 이동
     }
     node->output.push_back(patternIndex); // 패턴 인덱스를 출력 리스트에 추가
+    node->ownPatterns.push_back(patternIndex);
 }
 
 /*
@@ -96,6 +485,7 @@ void buildFailureLinks(TrieNode* root) {
     for (int i = 0; i < 4; ++i) {
         if (root->children[i]) {
             root->children[i]->failure = root;
+            root->failureChildren.push_back(root->children[i]);
             q.push(root->children[i]);
         }
     }
@@ -119,6 +509,7 @@ void buildFailureLinks(TrieNode* root) {
             }
 
             child->failure = failure; // 실패 함수 설정
+            failure->failureChildren.push_back(child);
 
             // 실패 노드의 출력 리스트를 현재 노드의 출력 리스트에 병합
             for (int patternIndex : failure->output) {
@@ -130,6 +521,239 @@ void buildFailureLinks(TrieNode* root) {
     }
 }
 
+/*
+    실패 트리(실패 함수의 역방향 트리)에서 node를 루트로 하는 서브트리를 순회하는 함수
+    node의 문자열을 접미사로 가지는 모든 노드를 방문한다.
+    visit가 false를 반환하면 해당 노드의 하위 노드는 방문하지 않음
+*/
+template <typename Visit>
+void visitFailureSubtree(TrieNode* node, Visit visit) {
+    std::vector<TrieNode*> stack = {node};
+    while (!stack.empty()) {
+        TrieNode* current = stack.back();
+        stack.pop_back();
+        if (!visit(current)) continue;
+        for (TrieNode* child : current->failureChildren) {
+            stack.push_back(child);
+        }
+    }
+}
+
+/*
+    current의 실패 노드를 newFailure로 바꾸고 실패 트리를 갱신하는 함수
+*/
+void relinkFailure(TrieNode* current, TrieNode* newFailure) {
+    std::vector<TrieNode*>& siblings = current->failure->failureChildren;
+    siblings.erase(std::find(siblings.begin(), siblings.end(), current));
+    current->failure = newFailure;
+    newFailure->failureChildren.push_back(current);
+}
+
+/*
+    실패 함수가 이미 구축된 트라이에 패턴을 증분 삽입하는 함수
+    새로 생긴 노드의 실패 함수만 계산하고, 새 노드를 접미사로 가지게 된 기존 노드의 실패 함수를 옮긴다.
+    패턴 인덱스는 종료 노드의 실패 서브트리에만 추가되므로 전체 BFS 없이 변경된 부분만 갱신
+    @parameters
+    - root: 트라이의 루트 노드
+    - pattern: 삽입할 패턴
+    - patternIndex: 패턴의 인덱스
+*/
+void addPatternIncremental(TrieNode* root, const std::string& pattern, int patternIndex) {
+    TrieNode* node = root;
+    for (char ch : pattern) {
+        int c = charToIndex(ch);
+        if (c == -1) continue; // 유효하지 않은 문자 무시
+        if (node->children[c] != nullptr) {
+            node = node->children[c];
+            continue;
+        }
+
+        // 새 노드 생성
+        TrieNode* parent = node;
+        TrieNode* created = new TrieNode();
+        created->parent = parent;
+        created->depth = parent->depth + 1;
+        parent->children[c] = created;
+
+        // 새 노드의 실패 함수 계산 (buildFailureLinks와 동일한 규칙)
+        TrieNode* failure = root;
+        if (parent != root) {
+            failure = parent->failure;
+            while (failure != root && failure->children[c] == nullptr) {
+                failure = failure->failure;
+            }
+            if (failure->children[c] && failure->children[c] != created) {
+                failure = failure->children[c];
+            }
+        }
+        created->failure = failure;
+        failure->failureChildren.push_back(created);
+        created->output = failure->output;
+
+        // parent의 문자열을 접미사로 가지는 노드 x에 대해, x의 자식(문자 c)이 더 짧은 실패 노드를
+        // 가리키고 있었다면 새 노드로 옮긴다. 더 깊은 실패 노드를 이미 가진 경우 그 아래는 볼 필요가 없다.
+        std::vector<TrieNode*> relinked;
+        visitFailureSubtree(parent, [&](TrieNode* x) {
+            if (x == parent || x == created) return true;
+            TrieNode* child = x->children[c];
+            if (child == nullptr) return true;
+            if (child->failure->depth < created->depth) relinked.push_back(child);
+            return false;
+        });
+        // 옮겨지는 노드의 기존 실패 노드는 새 노드의 실패 노드와 같으므로 출력 리스트는 바뀌지 않음
+        for (TrieNode* child : relinked) {
+            relinkFailure(child, created);
+        }
+
+        node = created;
+    }
+
+    // 종료 노드를 접미사로 가지는 모든 노드의 출력 리스트에 패턴 추가
+    node->ownPatterns.push_back(patternIndex);
+    visitFailureSubtree(node, [&](TrieNode* x) {
+        x->output.push_back(patternIndex);
+        return true;
+    });
+}
+
+/*
+    트라이에서 패턴을 증분 삭제하는 함수
+    종료 노드의 실패 서브트리에서 패턴 인덱스를 제거하고,
+    더 이상 어떤 패턴에도 쓰이지 않는 리프 노드를 잘라내면서 해당 노드를 가리키던 실패 함수를 옮긴다.
+    @parameters
+    - root: 트라이의 루트 노드
+    - pattern: 삭제할 패턴
+    - patternIndex: 패턴의 인덱스
+    @returns
+    - 패턴이 트라이에 있어서 삭제되었는지 여부
+*/
+bool removePatternIncremental(TrieNode* root, const std::string& pattern, int patternIndex) {
+    TrieNode* node = root;
+    for (char ch : pattern) {
+        int c = charToIndex(ch);
+        if (c == -1) continue; // 유효하지 않은 문자 무시
+        node = node->children[c];
+        if (node == nullptr) return false;
+    }
+    auto own = std::find(node->ownPatterns.begin(), node->ownPatterns.end(), patternIndex);
+    if (own == node->ownPatterns.end()) return false;
+    node->ownPatterns.erase(own);
+
+    // 종료 노드를 접미사로 가지는 모든 노드의 출력 리스트에서 패턴 제거
+    visitFailureSubtree(node, [&](TrieNode* x) {
+        auto it = std::find(x->output.begin(), x->output.end(), patternIndex);
+        if (it != x->output.end()) x->output.erase(it);
+        return true;
+    });
+
+    // 자식과 패턴이 없는 노드를 루트 방향으로 잘라냄
+    while (node != root && node->ownPatterns.empty() &&
+           std::all_of(node->children.begin(), node->children.end(), [](TrieNode* child) { return child == nullptr; })) {
+        TrieNode* parent = node->parent;
+        TrieNode* failure = node->failure;
+
+        // 이 노드를 실패 노드로 가지던 노드는 이 노드의 실패 노드를 가리키게 됨
+        for (TrieNode* x : node->failureChildren) {
+            x->failure = failure;
+            failure->failureChildren.push_back(x);
+        }
+        std::vector<TrieNode*>& siblings = failure->failureChildren;
+        siblings.erase(std::find(siblings.begin(), siblings.end(), node));
+
+        for (auto& child : parent->children) {
+            if (child == node) child = nullptr;
+        }
+        delete node;
+        node = parent;
+    }
+    return true;
+}
+
+// 검색 결과 출력 모드 (--count, --exists, --top, POSITIONS는 SNP를 표시하지 않는 쿼리 서버용)
+enum class OutputKind { FULL, POSITIONS, COUNT, EXISTS, TOP };
+
+struct OutputMode {
+    OutputKind kind = OutputKind::FULL;
+    long long topN = 0;     // TOP 모드에서 유지할 매칭 수
+
+    // 매칭 위치를 모두 저장하는 모드 (결과를 finishRecordScan으로 받고 결과 캐시를 사용할 수 있음)
+    bool keepsPositions() const { return kind == OutputKind::FULL || kind == OutputKind::POSITIONS; }
+};
+
+/*
+    검색 커널이 찾은 매칭을 출력 모드에 맞게 모으는 수집기
+    FULL은 모든 위치를 저장하고 SNP 위치를 표시하며, POSITIONS는 위치만 저장하고, COUNT는 개수만 세고,
+    EXISTS는 첫 매칭에서 found를 설정해 같은 패턴의 다른 작업도 멈추게 하고,
+    TOP은 (오차 수, 위치)가 가장 작은 topN개만 최대 힙으로 유지한다.
+*/
+class MatchCollector {
+public:
+    std::vector<long long> positions;                   // FULL: 매칭 위치
+    long long count = 0;                                // COUNT, EXISTS: 매칭 수
+    std::vector<std::pair<int, long long>> best;        // TOP: (오차 수, 위치) 최대 힙
+
+    MatchCollector() = default;
+    MatchCollector(const OutputMode& mode, std::atomic<bool>* found = nullptr) : mode(mode), found(found) {}
+
+    // SNP 위치 표시 여부 (FULL 모드에서만)
+    bool markSnps() const { return mode.kind == OutputKind::FULL; }
+
+    // 같은 패턴을 다른 작업에서 이미 찾았으면 검색을 멈춤 (EXISTS)
+    bool stopped() const { return found && found->load(std::memory_order_relaxed); }
+
+    /*
+        매칭 하나를 추가하는 함수
+        @returns
+        - 계속 검색해야 하면 true (EXISTS 모드에서 찾으면 false)
+    */
+    bool add(long long position, int mismatches) {
+        switch (mode.kind) {
+            case OutputKind::FULL:
+            case OutputKind::POSITIONS:
+                positions.push_back(position);
+                return true;
+            case OutputKind::COUNT:
+                ++count;
+                return true;
+            case OutputKind::EXISTS:
+                ++count;
+                if (found) found->store(true, std::memory_order_relaxed);
+                return false;
+            case OutputKind::TOP:
+                best.emplace_back(mismatches, position);
+                std::push_heap(best.begin(), best.end());
+                if (static_cast<long long>(best.size()) > mode.topN) {
+                    std::pop_heap(best.begin(), best.end());
+                    best.pop_back();
+                }
+                return true;
+        }
+        return true;
+    }
+
+    // 위치 없이 매칭 수만 추가 (COUNT, EXISTS)
+    void addCount(long long n) {
+        count += n;
+        if (mode.kind == OutputKind::EXISTS && n > 0 && found) found->store(true, std::memory_order_relaxed);
+    }
+
+    // 같은 모드의 빈 수집기 (구간을 나누어 검색할 때 사용)
+    MatchCollector emptyCopy() const { return MatchCollector(mode, found); }
+
+    // 다른 수집기(뒤쪽 구간)의 결과를 합침
+    void merge(MatchCollector&& other) {
+        positions.insert(positions.end(), other.positions.begin(), other.positions.end());
+        count += other.count;
+        for (const auto& hit : other.best) {
+            add(hit.second, hit.first);
+        }
+    }
+
+private:
+    OutputMode mode;
+    std::atomic<bool>* found = nullptr;
+};
+
 /*
     Aho-Corasick 알고리즘을 사용한 오차 허용 매칭 함수
     @parameters
@@ -139,11 +763,12 @@ void buildFailureLinks(TrieNode* root) {
     - d: 허용할 오차 개수
     - start_pos: 검색 시작 위치
     - end_pos: 검색 종료 위치
-    @returns
-    - 매칭된 위치의 벡터
+    - text_offset: text가 전체 서열에서 시작하는 위치 (SNP 위치 기록용)
+    - collector: 매칭 수집기 (매칭 위치는 text 기준 위치)
 */
-std::vector<long long> aho_corasick_search_approx(
-    const std::string& text, TrieNode* root, const std::string& pattern, int d, long long start_pos, long long end_pos) {
+void aho_corasick_search_approx(
+    const std::string& text, TrieNode* root, const std::string& pattern, int d, long long start_pos, long long end_pos,
+    long long text_offset, MatchCollector& collector) {
     
     long long n = end_pos - start_pos; // 검색할 텍스트 길이
     int m = pattern.length(); // 패턴 길이
@@ -187,9 +812,9 @@ std::vector<long long> aho_corasick_search_approx(
     std::vector<bool> activeStates(totalStates, false); // 현재 활성 상태를 추적
     activeStates[stateID(0, 0)] = true; // 초기 상태 활성화
 
-    std::vector<long long> matches; // 매칭된 위치를 저장할 벡터
+    long long lastMatchIndex = -1; // 마지막으로 확인한 매칭 위치
 
-    for (long long pos = 0; pos < n; ++pos) {
+    for (long long pos = 0; pos < n && !collector.stopped(); ++pos) {
         int c = charToIndex(text[start_pos + pos]);
         if (c == -1) {
             // 유효하지 않은 문자면 루트 상태로 초기화
@@ -214,7 +839,9 @@ std::vector<long long> aho_corasick_search_approx(
                         long long matchIndex = pos - m + 1;
 
                         // 매칭 조건 강화 (오차 허용)
-                        if (matchIndex >= 0 && matchIndex + m <= n) {
+                        // 같은 위치에서 여러 상태가 수락 상태에 도달해도 한 번만 확인
+                        if (matchIndex >= 0 && matchIndex + m <= n && matchIndex != lastMatchIndex) {
+                            lastMatchIndex = matchIndex;
                             int mismatchCount = 0;
                             bool validMatch = true;
 
@@ -230,14 +857,17 @@ std::vector<long long> aho_corasick_search_approx(
 
                             if (validMatch) { // 유효한 매칭인 경우
                                 long long actualMatchIndex = start_pos + matchIndex;
-                                matches.push_back(actualMatchIndex);
+                                if (!collector.add(actualMatchIndex, mismatchCount)) {
+                                    total_processed += n - pos;
+                                    return;
+                                }
 
                                 // SNP 위치 기록
-                                for (int k = 0; k < m; ++k) {
+                                for (int k = 0; k < m && collector.markSnps(); ++k) {
                                     if (text[start_pos + matchIndex + k] != pattern[k]) {
-                                        long long snpPos = start_pos + matchIndex + k;
+                                        long long snpPos = text_offset + start_pos + matchIndex + k;
                                         if (snpPos >= 0 && snpPos < (long long)globalSnpPositions.size()) {
-                                            globalSnpPositions[snpPos] = true;
+                                            globalSnpPositions.set(snpPos);
                                         }
                                     }
                                 }
@@ -256,208 +886,3305 @@ std::vector<long long> aho_corasick_search_approx(
         // 진행률 업데이트
         total_processed++;
     }
-
-    return matches;
 }
 
 /*
-    파일에서 DNA 염기서열을 읽는 함수
-    FASTA 또는 일반 텍스트 파일에서 서열을 읽어들임
+    패턴 길이 M과 허용 오차 D를 컴파일 시간에 고정한 오차 허용 매칭 함수
+    aho_corasick_search_approx와 같은 상태 (i, e)를 사용하지만, 오차 수 e마다 하나의 64비트 워드에
+    "패턴의 i번째 문자까지 e개의 오차로 일치" 여부를 비트 i-1로 저장한다.
+    상태 전이가 시프트와 비트 연산으로 바뀌고 상태 배열의 크기가 고정되므로
+    컴파일러가 오차 수에 대한 루프를 펼치고 상태를 레지스터에 유지할 수 있다.
     @parameters
-    - fileName: 서열 데이터가 포함된 파일 이름
-    @returns
-    - 읽어들인 서열 문자열
+    - text: 전체 텍스트 문자열
+    - pattern: 검색할 패턴 문자열 (길이 M)
+    - start_pos: 검색 시작 위치
+    - end_pos: 검색 종료 위치
+    - text_offset: text가 전체 서열에서 시작하는 위치 (SNP 위치 기록용)
+    - collector: 매칭 수집기 (매칭 위치는 text 기준 위치)
 */
-std::string readSequenceFromFile(const std::string& fileName) {
-    std::ifstream inputFile(fileName);
-    if (!inputFile) {
-        std::cerr << "파일을 열 수 없습니다: " << fileName << std::endl;
-        exit(1);
-    }
+template <int M, int D>
+void searchApproxFixed(const std::string& text, const std::string& pattern, long long start_pos, long long end_pos,
+                       long long text_offset, MatchCollector& collector) {
+    static_assert(M >= 1 && M <= 64, "패턴이 64비트 워드에 들어가야 함");
 
-    std::string text;
-    std::string line;
+    constexpr uint64_t ACCEPT = 1ULL << (M - 1); // 상태 (M, e): 패턴 전체가 e개 이하의 오차로 일치
+    constexpr long long PROGRESS_BATCH = 1 << 16; // 진행률 원자 변수 갱신 주기
 
-    // 파일 확장자 확인
-    std::string extension;
-    size_t dotPos = fileName.find_last_of(".");
-    if (dotPos != std::string::npos) {
-        extension = fileName.substr(dotPos + 1);
-        std::transform(extension.begin(), extension.end(), extension.begin(),
-                       [](unsigned char c) { return std::tolower(c); });
+    // 문자별 일치 마스크: charMask[c]의 비트 i는 pattern[i] == c 여부
+    std::array<uint64_t, 4> charMask = {0, 0, 0, 0};
+    for (int i = 0; i < M; ++i) {
+        int c = charToIndex(pattern[i]);
+        if (c != -1) charMask[c] |= 1ULL << i;
     }
 
-    if (extension == "fa" || extension == "fasta") {
-        // .fa 또는 .fasta 파일인 경우
-        while (std::getline(inputFile, line)) {
-            if (line.empty()) continue;
-            if (line[0] == '>') {
-                // 헤더 라인 무시
-                continue;
-            } else {
-                // 공백 제거 및 서열 라인 연결
-                line.erase(std::remove_if(line.begin(), line.end(),
-                                          [](unsigned char c) { return std::isspace(c); }), line.end());
-                text += line;
-            }
+    std::array<uint64_t, D + 1> active{}; // active[e]: 오차 e개로 도달한 상태 집합
+    long long reported = 0; // 이미 total_processed에 반영한 처리량
+
+    for (long long pos = start_pos; pos < end_pos; ++pos) {
+        if (pos - start_pos - reported == PROGRESS_BATCH) {
+            total_processed += PROGRESS_BATCH;
+            reported += PROGRESS_BATCH;
+            if (collector.stopped()) break;
         }
-    } else {
-        // 일반 텍스트 파일인 경우
-        while (std::getline(inputFile, line)) {
-            if (line.empty()) continue;
-            // 공백 제거 및 라인 연결
-            line.erase(std::remove_if(line.begin(), line.end(),
-                                      [](unsigned char c) { return std::isspace(c); }), line.end());
-            text += line;
+
+        int c = BASE_CODES[static_cast<unsigned char>(text[pos])];
+        if (c == -1) {
+            // 유효하지 않은 문자면 루트 상태로 초기화
+            active.fill(0);
+            continue;
         }
-    }
 
-    inputFile.close();
+        // 일치하면 (i, e) → (i+1, e), 불일치하면 (i, e-1) → (i+1, e). 초기 상태 (0, 0)은 항상 활성
+        uint64_t match = charMask[c];
+        uint64_t accepted = 0;
+        for (int e = D; e >= 1; --e) {
+            uint64_t fromLower = (active[e - 1] << 1) | (e == 1 ? 1ULL : 0ULL);
+            active[e] = ((active[e] << 1) & match) | (fromLower & ~match);
+            accepted |= active[e];
+        }
+        active[0] = ((active[0] << 1) | 1ULL) & match;
+        accepted |= active[0];
 
-    if (text.empty()) {
-        std::cerr << "서열 데이터가 없습니다." << std::endl;
-        exit(1);
+        if (accepted & ACCEPT) {
+            long long matchIndex = pos - M + 1;
+            int mismatches = 0;
+            while (!(active[mismatches] & ACCEPT)) ++mismatches;
+            if (!collector.add(matchIndex, mismatches)) break;
+
+            // SNP 위치 기록
+            for (int k = 0; k < M && collector.markSnps(); ++k) {
+                if (text[matchIndex + k] != pattern[k]) {
+                    long long snpPos = text_offset + matchIndex + k;
+                    if (snpPos >= 0 && snpPos < (long long)globalSnpPositions.size()) {
+                        globalSnpPositions.set(snpPos);
+                    }
+                }
+            }
+        }
     }
+    // 일찍 멈춘 경우 남은 구간도 처리한 것으로 반영
+    total_processed += end_pos - start_pos - reported;
+}
+
+// 특수화된 검색 커널의 함수 포인터 형식
+using SearchKernel = void (*)(const std::string&, const std::string&, long long, long long, long long, MatchCollector&);
 
-    std::cout << "서열의 길이: " << text.length() << std::endl;
-    return text;
+/*
+    패턴 길이 M에 대해 d에 맞는 특수화 커널을 고르는 함수 (d ≤ 4)
+*/
+template <int M>
+SearchKernel selectKernelForLength(int d) {
+    switch (d) {
+        case 0: return &searchApproxFixed<M, 0>;
+        case 1: return &searchApproxFixed<M, 1>;
+        case 2: return &searchApproxFixed<M, 2>;
+        case 3: return &searchApproxFixed<M, 3>;
+        case 4: return &searchApproxFixed<M, 4>;
+        default: return nullptr;
+    }
 }
 
 /*
-    매칭 결과를 기반으로 텍스트를 변환하고 파일로 저장하는 함수
+    자주 쓰는 (패턴 길이, d) 조합에 대해 특수화된 검색 커널을 고르는 함수
     @parameters
-    - originalText: 원본 문자열
-    - matches: 매칭된 위치의 벡터 (패턴별 매칭 위치)
-    - sequences: 비교에 사용된 패턴 문자열 리스트
-    - transitionProb: 전이 확률 행렬
-    - outputFileName: 저장할 파일 이름
+    - m: 패턴 길이
+    - d: 허용할 오차 개수
+    @returns
+    - 특수화된 커널 (해당하는 조합이 없으면 nullptr, 이 경우 aho_corasick_search_approx 사용)
 */
-void saveTransformedTextToFile(
-    const std::string& originalText,
-    const std::vector<std::vector<long long>>& matches,
-    const std::vector<std::string>& sequences,
-    const std::vector<std::vector<double>>& transitionProb,
-    const std::string& outputFileName) {
-    
-    std::ofstream outputFile(outputFileName);
-    if (!outputFile) {
-        std::cerr << "파일을 생성할 수 없습니다: " << outputFileName << std::endl;
-        exit(1);
+SearchKernel selectSpecializedKernel(int m, int d) {
+    switch (m) {
+        case 16: return selectKernelForLength<16>(d);
+        case 20: return selectKernelForLength<20>(d);
+        case 24: return selectKernelForLength<24>(d);
+        case 32: return selectKernelForLength<32>(d);
+        case 64: return selectKernelForLength<64>(d);
+        default: return nullptr;
     }
+}
 
-    // 결과 텍스트를 저장할 문자열
-    std::string resultText = originalText;
+/*
+    큰 검색 테이블용 할당자
+    useHugePages가 켜져 있으면 2 MiB 이상의 할당을 mmap으로 받아 MADV_HUGEPAGE를 요청한다.
+    테이블 조회마다 생기는 TLB 미스를 줄이기 위한 것으로, 커널이 huge page를 주지 않으면 일반 페이지로 동작
+*/
+template <typename T>
+struct HugePageAllocator {
+    using value_type = T;
+    static const size_t HUGE_PAGE_SIZE = 2 << 20;
 
-    // 오차 발생 시 전이 확률 행렬을 기반으로 새로운 문자 생성
-    auto generateRandomBase = [&](char currentBase) -> char {
-        static const char bases[] = {'A', 'T', 'C', 'G'};
-        int currentIndex = charToIndex(currentBase);
-        if (currentIndex == -1) return currentBase; // 유효하지 않은 문자 처리
+    HugePageAllocator() = default;
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U>&) {}
 
-        // 전이 확률을 기반으로 랜덤 선택
-        double r = (double)rand() / RAND_MAX;
-        double cumulative = 0.0;
-        for (int i = 0; i < 4; ++i) {
-            cumulative += transitionProb[currentIndex][i];
-            if (r <= cumulative) {
-                return bases[i];
+    T* allocate(size_t n) {
+        if (mapped(n)) {
+            // mmap은 4 KiB 단위로만 정렬하므로 2 MiB만큼 더 받아 시작을 올림 정렬하고 앞뒤 나머지는 해제
+            size_t length = mappedLength(n);
+            void* p = ::mmap(nullptr, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) throw std::bad_alloc();
+            uintptr_t base = reinterpret_cast<uintptr_t>(p);
+            uintptr_t aligned = (base + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1);
+            if (aligned > base) ::munmap(p, aligned - base);
+            if (HUGE_PAGE_SIZE > aligned - base) {
+                ::munmap(reinterpret_cast<void*>(aligned + length), HUGE_PAGE_SIZE - (aligned - base));
             }
+            ::madvise(reinterpret_cast<void*>(aligned), length, MADV_HUGEPAGE);
+            return reinterpret_cast<T*>(aligned);
         }
-        return currentBase; // 기본적으로 현재 문자 반환
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) {
+        if (mapped(n)) {
+            ::munmap(p, mappedLength(n));
+        } else {
+            std::allocator<T>().deallocate(p, n);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const HugePageAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const HugePageAllocator<U>&) const { return false; }
+
+private:
+    static bool mapped(size_t n) { return useHugePages && n * sizeof(T) >= HUGE_PAGE_SIZE; }
+    static size_t mappedLength(size_t n) { return (n * sizeof(T) + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE; }
+};
+
+/*
+    짧은 패턴 집합을 위한 2비트 k-mer 해시 엔진
+    텍스트를 한 번 읽으면서 염기당 2비트의 롤링 코드를 유지하고, 각 위치에서 끝나는 k-mer 코드를
+    패턴 코드의 해시 테이블에서 찾는다. 패턴 수와 관계없이 위치당 해시 조회 몇 번이면 되므로
+    패턴이 많을 때 트라이를 따라가며 생기는 캐시 미스가 없다.
+    d = 1이면 각 패턴의 1-오차 이웃(3k개)을 미리 테이블에 넣고, 이웃이 너무 많으면
+    텍스트 k-mer의 이웃을 조회 시점에 만들어 찾는다.
+*/
+class KmerProbeTable {
+public:
+    static const int MAX_K = 32;                                // 64비트 워드에 들어가는 최대 패턴 길이
+    static const long long MAX_NEIGHBORHOOD_ENTRIES = 1LL << 24; // 미리 만들 1-오차 이웃의 최대 개수
+    static const int BLOCK = 256;                               // 코드를 미리 계산하는 위치 수
+    static const int PREFETCH_DISTANCE = 16;                    // 비트 필터를 미리 읽어 두는 거리
+    static const int SLOT_PREFETCH_DISTANCE = 8;                // 슬롯을 미리 읽어 두는 조회 수
+    static const int MAX_PROBES = 1024;                         // 한 번에 모아 두는 조회 수 (BLOCK 이상)
+
+    // 모든 패턴이 64비트 워드에 들어가고 (A, T, C, G만 포함) d ≤ 1이면 사용 가능
+    static bool applicable(const std::vector<std::string>& patterns, int d) {
+        if (d < 0 || d > 1 || patterns.empty()) return false;
+        for (const std::string& pattern : patterns) {
+            if (pattern.empty() || pattern.length() > MAX_K ||
+                pattern.find_first_not_of("ATCG") != std::string::npos) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    KmerProbeTable(const std::vector<std::string>& patterns, int d) : d(d) {
+        // 패턴 코드 계산 (마지막 염기가 가장 낮은 2비트)
+        std::map<int, std::vector<std::pair<uint64_t, uint32_t>>> entriesByLength;
+        for (size_t p = 0; p < patterns.size(); ++p) {
+            uint64_t code = 0;
+            for (char c : patterns[p]) {
+                code = (code << 2) | charToIndex(c);
+            }
+            patternCodes.push_back(code);
+            patternLengths.push_back(patterns[p].length());
+            entriesByLength[patterns[p].length()].emplace_back(code, p);
+        }
+
+        for (auto& group : entriesByLength) {
+            int k = group.first;
+            std::vector<std::pair<uint64_t, uint32_t>>& entries = group.second;
+
+            LengthTable table;
+            table.k = k;
+            table.mask = k == MAX_K ? ~0ULL : ((1ULL << (2 * k)) - 1);
+            table.neighborhoods = d == 1 && static_cast<long long>(entries.size()) * (3 * k + 1) <= MAX_NEIGHBORHOOD_ENTRIES;
+            if (table.neighborhoods) {
+                size_t numProbes = entries.size();
+                for (size_t e = 0; e < numProbes; ++e) {
+                    for (int i = 0; i < k; ++i) {
+                        for (uint64_t alt = 1; alt < 4; ++alt) {
+                            entries.emplace_back(entries[e].first ^ (alt << (2 * i)), entries[e].second);
+                        }
+                    }
+                }
+            }
+            buildTable(table, entries);
+            tables.push_back(std::move(table));
+        }
+    }
+
+    /*
+        텍스트의 [start_pos, end_pos) 구간에서 모든 패턴을 한 번에 검색하는 함수
+        @parameters
+        - text: 전체 텍스트 문자열
+        - start_pos: 검색 시작 위치
+        - end_pos: 검색 종료 위치
+        - onHit: 매칭마다 (패턴 인덱스, 매칭 위치, 불일치 코드)로 호출되는 함수 (위치는 text 기준 위치)
+          불일치 코드는 텍스트와 패턴 코드의 XOR로, 0이 아닌 2비트 그룹이 불일치 위치
+    */
+    template <typename OnHit>
+    void search(const std::string& text, long long start_pos, long long end_pos, OnHit&& onHit) const {
+        uint64_t code = 0;      // 롤링 k-mer 코드
+        int valid = 0;          // 마지막 유효하지 않은 문자 이후 읽은 염기 수
+        std::array<uint64_t, BLOCK> codes;
+        std::array<int, BLOCK> valids;
+        std::array<Probe, MAX_PROBES> probes; // 비트 필터를 통과한 조회 (위치 순서)
+
+        // 블록 단위로 코드를 먼저 계산한 뒤, PREFETCH_DISTANCE 앞의 비트 필터를 미리 읽어 두며 조회
+        for (long long blockStart = start_pos; blockStart < end_pos; blockStart += BLOCK) {
+            int n = std::min<long long>(BLOCK, end_pos - blockStart);
+            for (int i = 0; i < n; ++i) {
+                int c = BASE_CODES[static_cast<unsigned char>(text[blockStart + i])];
+                if (c == -1) {
+                    valid = 0;
+                } else {
+                    code = (code << 2) | c;
+                    if (valid < MAX_K) valid++;
+                }
+                codes[i] = code;
+                valids[i] = valid;
+            }
+
+            // 위치마다의 조회는 서로 독립적이므로, 블록 전체의 비트 필터를 분기 없이 먼저 확인해 통과한 조회를 모으고
+            // 모은 조회의 슬롯은 SLOT_PREFETCH_DISTANCE 앞을 미리 읽어 두며 탐사해 여러 캐시 미스가 겹치도록 함
+            for (const LengthTable& table : tables) {
+                bool enumerate = d == 1 && !table.neighborhoods; // 텍스트 k-mer의 1-오차 이웃을 만들어 조회
+                int numProbes = 0;
+                for (int i = 0; i < n; ++i) {
+                    if (i + PREFETCH_DISTANCE < n && valids[i + PREFETCH_DISTANCE] >= table.k) {
+                        uint64_t ahead = codes[i + PREFETCH_DISTANCE] & table.mask;
+                        prefetchFilter(table, ahead);
+                        if (enumerate) {
+                            for (int j = 0; j < table.k; ++j) {
+                                for (uint64_t alt = 1; alt < 4; ++alt) {
+                                    prefetchFilter(table, ahead ^ (alt << (2 * j)));
+                                }
+                            }
+                        }
+                    }
+                    if (valids[i] < table.k) continue;
+
+                    uint64_t window = codes[i] & table.mask;
+                    probes[numProbes] = {i, window};
+                    numProbes += passesFilter(table, window);
+                    if (enumerate) {
+                        for (int j = 0; j < table.k; ++j) {
+                            for (uint64_t alt = 1; alt < 4; ++alt) {
+                                uint64_t neighbor = window ^ (alt << (2 * j));
+                                probes[numProbes] = {i, neighbor};
+                                numProbes += passesFilter(table, neighbor);
+                            }
+                        }
+                        if (numProbes > MAX_PROBES - (3 * MAX_K + 1)) {
+                            resolveProbes(table, probes.data(), numProbes, blockStart, codes.data(), onHit);
+                            numProbes = 0;
+                        }
+                    }
+                }
+                resolveProbes(table, probes.data(), numProbes, blockStart, codes.data(), onHit);
+            }
+        }
+        total_processed += end_pos - start_pos;
+    }
+
+    /*
+        매칭 하나의 불일치 위치를 SNP로 기록하는 함수
+        @parameters
+        - p: 패턴 인덱스
+        - matchIndex: 매칭 위치 (text 기준 위치)
+        - diff: search가 전달한 불일치 코드
+        - text_offset: text가 전체 서열에서 시작하는 위치
+    */
+    void markSnps(int p, long long matchIndex, uint64_t diff, long long text_offset) const {
+        int k = patternLengths[p];
+        while (diff) {
+            int group = __builtin_ctzll(diff) / 2;
+            long long snpPos = text_offset + matchIndex + (k - 1 - group);
+            if (snpPos >= 0 && snpPos < globalSnpPositions.size()) {
+                globalSnpPositions.set(snpPos);
+            }
+            diff &= ~(3ULL << (2 * group));
+        }
+    }
+
+    int patternLength(int p) const { return patternLengths[p]; }
+
+    // 불일치 코드의 불일치 개수
+    static int mismatchCount(uint64_t diff) {
+        return __builtin_popcountll((diff | (diff >> 1)) & 0x5555555555555555ULL);
+    }
+
+private:
+    struct Slot {
+        uint64_t code = 0;
+        uint32_t first = 0;     // postings에서 이 코드의 패턴 인덱스가 시작하는 위치
+        uint32_t count = 0;     // 패턴 인덱스 개수 (0이면 빈 슬롯)
+    };
+
+    // 패턴 길이 k별 해시 테이블 (선형 탐사)
+    // 대부분의 텍스트 k-mer는 테이블에 없으므로, 코드당 약 32비트의 비트 필터를 먼저 확인해
+    // 슬롯 탐사에서 생기는 분기 예측 실패와 캐시 미스를 줄임
+    struct LengthTable {
+        int k = 0;
+        uint64_t mask = 0;
+        bool neighborhoods = false;     // 1-오차 이웃을 미리 넣었는지 여부
+        int shift = 64;
+        size_t slotMask = 0;
+        int filterShift = 64;
+        std::vector<uint64_t, HugePageAllocator<uint64_t>> filter;  // 해시 상위 비트로 표시한 비트 필터
+        std::vector<Slot, HugePageAllocator<Slot>> slots;
+        std::vector<uint32_t> postings; // 코드별 패턴 인덱스
+    };
+
+    // 블록 안 위치 offset에서 조회할 코드
+    struct Probe {
+        int offset;
+        uint64_t code;
+    };
+
+    int d;
+    std::vector<uint64_t> patternCodes;
+    std::vector<int> patternLengths;
+    std::vector<LengthTable> tables;
+
+    static uint64_t hashOf(uint64_t code) {
+        return code * 0x9E3779B97F4A7C15ULL;
+    }
+
+    // (코드, 패턴 인덱스) 목록을 정렬해 코드별 패턴 인덱스 리스트와 해시 테이블을 만듦
+    static void buildTable(LengthTable& table, std::vector<std::pair<uint64_t, uint32_t>>& entries) {
+        std::sort(entries.begin(), entries.end());
+        entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+        size_t uniqueCodes = 0;
+        for (size_t e = 0; e < entries.size(); ++e) {
+            if (e == 0 || entries[e].first != entries[e - 1].first) uniqueCodes++;
+        }
+        int bits = 1;
+        while ((1ULL << bits) < uniqueCodes * 2) bits++; // 적재율 50% 이하
+        table.shift = 64 - bits;
+        table.slots.assign(1ULL << bits, Slot());
+        table.slotMask = table.slots.size() - 1;
+        int filterBits = 6;
+        while ((1ULL << filterBits) < uniqueCodes * 32) filterBits++;
+        table.filterShift = 64 - filterBits;
+        table.filter.assign(1ULL << (filterBits - 6), 0);
+        table.postings.reserve(entries.size());
+
+        for (size_t e = 0; e < entries.size();) {
+            Slot slot;
+            slot.code = entries[e].first;
+            slot.first = table.postings.size();
+            for (; e < entries.size() && entries[e].first == slot.code; ++e) {
+                table.postings.push_back(entries[e].second);
+            }
+            slot.count = table.postings.size() - slot.first;
+
+            uint64_t f = hashOf(slot.code) >> table.filterShift;
+            table.filter[f >> 6] |= 1ULL << (f & 63);
+            size_t s = hashOf(slot.code) >> table.shift;
+            while (table.slots[s].count != 0) {
+                s = (s + 1) & table.slotMask;
+            }
+            table.slots[s] = slot;
+        }
+    }
+
+    static void prefetchFilter(const LengthTable& table, uint64_t code) {
+        __builtin_prefetch(&table.filter[(hashOf(code) >> table.filterShift) >> 6]);
+    }
+
+    static void prefetchSlot(const LengthTable& table, uint64_t code) {
+        __builtin_prefetch(&table.slots[hashOf(code) >> table.shift]);
+    }
+
+    // code가 비트 필터를 통과하는지 여부 (통과하지 않으면 테이블에 없음)
+    static bool passesFilter(const LengthTable& table, uint64_t code) {
+        uint64_t f = hashOf(code) >> table.filterShift;
+        return (table.filter[f >> 6] >> (f & 63)) & 1;
+    }
+
+    // code의 슬롯을 찾음 (없으면 nullptr)
+    static const Slot* findSlot(const LengthTable& table, uint64_t code) {
+        for (size_t s = hashOf(code) >> table.shift;; s = (s + 1) & table.slotMask) {
+            const Slot& slot = table.slots[s];
+            if (slot.count == 0) return nullptr;
+            if (slot.code == code) return &slot;
+        }
+    }
+
+    /*
+        비트 필터를 통과한 조회들의 슬롯을 탐사해 매칭을 전달하는 함수
+        @parameters
+        - table: 조회한 길이별 테이블
+        - probes: 블록 안 위치 순서로 모은 조회
+        - numProbes: 조회 수
+        - blockStart: 블록이 시작하는 text 위치
+        - codes: 블록의 위치별 롤링 코드
+        - onHit: search의 onHit
+    */
+    template <typename OnHit>
+    void resolveProbes(const LengthTable& table, const Probe* probes, int numProbes, long long blockStart,
+                       const uint64_t* codes, OnHit& onHit) const {
+        for (int q = 0; q < std::min(numProbes, SLOT_PREFETCH_DISTANCE); ++q) {
+            prefetchSlot(table, probes[q].code);
+        }
+        for (int q = 0; q < numProbes; ++q) {
+            if (q + SLOT_PREFETCH_DISTANCE < numProbes) {
+                prefetchSlot(table, probes[q + SLOT_PREFETCH_DISTANCE].code);
+            }
+            if (const Slot* slot = findSlot(table, probes[q].code)) {
+                int i = probes[q].offset;
+                report(table, *slot, blockStart + i - table.k + 1, codes[i] & table.mask, onHit);
+            }
+        }
+    }
+
+    // 슬롯의 패턴들에 대한 매칭을 전달 (window는 텍스트의 실제 k-mer 코드)
+    template <typename OnHit>
+    void report(const LengthTable& table, const Slot& slot, long long matchIndex, uint64_t window, OnHit& onHit) const {
+        for (uint32_t j = slot.first; j < slot.first + slot.count; ++j) {
+            int p = table.postings[j];
+            onHit(p, matchIndex, window ^ patternCodes[p]);
+        }
+    }
+};
+
+/*
+    패턴 집합에 맞는 k-mer 엔진을 반환하는 함수
+    여러 레코드가 같은 패턴 집합을 검색하므로 마지막으로 만든 테이블을 재사용
+    @parameters
+    - patterns: 검색할 패턴 리스트
+    - d: 허용할 오차 개수
+    @returns
+    - k-mer 엔진 (사용할 수 없는 패턴 집합이면 nullptr)
+*/
+std::shared_ptr<const KmerProbeTable> kmerTableFor(const std::vector<std::string>& patterns, int d) {
+    if (!KmerProbeTable::applicable(patterns, d)) return nullptr;
+
+    static std::mutex cacheMutex;
+    static std::vector<std::string> cachedPatterns;
+    static int cachedD = -1;
+    static std::shared_ptr<const KmerProbeTable> cachedTable;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (!cachedTable || cachedD != d || cachedPatterns != patterns) {
+        ScopedPhase phase("kmer_build");
+        cachedTable = std::make_shared<KmerProbeTable>(patterns, d);
+        cachedPatterns = patterns;
+        cachedD = d;
+    }
+    return cachedTable;
+}
+
+/*
+    파이프라인 단계 사이를 연결하는 크기 제한 lock-free 큐
+    생산자 1개와 소비자 1개만 사용하는 원형 버퍼(SPSC)로, 뮤텍스 없이 원자적 인덱스만 사용
+    큐가 가득 차면 push가, 비어 있으면 pop이 대기하므로 파이프라인의 메모리 사용량이 제한된다.
+    생산자가 close()를 호출하면 남은 항목을 모두 꺼낸 뒤 pop이 false를 반환
+*/
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : buffer(capacity + 1), head(0), tail(0), closed(false) {}
+
+    // 항목을 큐에 넣는다. 큐가 가득 차 있으면 공간이 생길 때까지 대기
+    void push(T item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t next = (t + 1) % buffer.size();
+        for (int spin = 0; next == head.load(std::memory_order_acquire); ++spin) {
+            backoff(spin);
+        }
+        buffer[t] = std::move(item);
+        tail.store(next, std::memory_order_release);
+    }
+
+    // 항목을 꺼낸다. 큐가 닫혔고 비어 있으면 false 반환
+    bool pop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        for (int spin = 0; h == tail.load(std::memory_order_acquire); ++spin) {
+            if (closed.load(std::memory_order_acquire)) {
+                // close 직전에 들어온 항목이 있는지 한 번 더 확인
+                if (h == tail.load(std::memory_order_acquire)) return false;
+                break;
+            }
+            backoff(spin);
+        }
+        item = std::move(buffer[h]);
+        head.store((h + 1) % buffer.size(), std::memory_order_release);
+        return true;
+    }
+
+    // 생산자가 더 이상 항목을 넣지 않음을 알림
+    void close() {
+        closed.store(true, std::memory_order_release);
+    }
+
+private:
+    // 짧게는 양보하고, 대기가 길어지면 잠들어 CPU를 점유하지 않도록 함
+    static void backoff(int spin) {
+        if (spin < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+
+    std::vector<T> buffer;
+    alignas(64) std::atomic<size_t> head; // 소비자가 다음에 읽을 위치
+    alignas(64) std::atomic<size_t> tail; // 생산자가 다음에 쓸 위치
+    std::atomic<bool> closed;
+};
+
+// 파이프라인 설정값
+const size_t READ_BLOCK_SIZE = 4 << 20;     // 한 번에 읽는 파일 블록 크기 (4 MiB)
+const unsigned READ_DEPTH = 4;              // 동시에 진행되는 읽기 요청 수
+const size_t RAW_QUEUE_CAPACITY = 8;        // 로더 → 패커 큐 크기 (블록 단위)
+const size_t RECORD_QUEUE_CAPACITY = 2;     // 패커 → 스캐너, 스캐너 → 기록 큐 크기 (레코드 단위)
+
+/*
+    파일에서 읽어들인 원시 데이터 블록
+    endOfFile이 true이면 해당 파일의 끝을 나타내는 빈 블록
+*/
+struct RawBlock {
+    int fileIndex = 0;
+    std::string data;
+    bool endOfFile = false;
+};
+
+/*
+    입력 파일 정보
+    label과 start는 일반 텍스트 파일(예: parsing.py가 만든 out_put_N.txt)의 좌표를 지정할 때 사용하며,
+    FASTA 레코드는 헤더 이름과 위치 0을 사용
+*/
+struct InputFile {
+    std::string path;
+    std::string label;      // 레코드 이름 (염색체 등, 비어 있으면 파일 이름)
+    long long start = 0;    // label 안에서 이 파일이 시작하는 위치
+};
+
+/*
+    패커가 만들어낸 서열 레코드
+    FASTA 파일은 헤더(>)마다 하나의 레코드가 되고, 일반 텍스트 파일은 파일 전체가 하나의 레코드
+    offset은 모든 레코드를 이어붙였을 때 이 레코드가 시작하는 위치 (전역 위치),
+    name과 position은 염색체 이름과 그 안에서 이 레코드가 시작하는 위치
+    seamSplit이 0보다 크면 이어진 두 레코드의 경계를 검색하기 위한 이음 레코드로,
+    text의 앞 seamSplit개 염기는 앞 레코드의 끝부분이고 경계를 지나는 매칭만 찾는다.
+*/
+struct SequenceRecord {
+    std::string name;
+    long long offset = 0;
+    long long position = 0;
+    std::string text;
+    long long seamSplit = 0;
+};
+
+/*
+    두 레코드가 같은 염색체에서 연속된 구간인지 확인하는 함수
+    (예: manifest에서 한 염색체를 같은 이름과 이어지는 시작 위치로 나눈 파일들)
+*/
+bool contiguousRecords(const SequenceRecord& prev, const SequenceRecord& next) {
+    long long length = prev.text.length();
+    return length > 0 && prev.name == next.name && prev.position + length == next.position &&
+           prev.offset + length == next.offset;
+}
+
+/*
+    레코드의 끝부분 최대 n개 염기만 담은 레코드를 반환하는 함수
+    레코드가 n보다 짧고 직전 끝부분(previousTail)과 이어지면 둘을 합쳐 n개를 유지
+    @parameters
+    - previousTail: 직전 레코드에 대해 이 함수가 반환한 끝부분
+    - record: 레코드
+    - n: 유지할 염기 수 (가장 긴 패턴 길이 - 1)
+*/
+SequenceRecord recordTail(const SequenceRecord& previousTail, const SequenceRecord& record, long long n) {
+    SequenceRecord tail;
+    long long length = record.text.length();
+    if (length >= n) {
+        tail.text = record.text.substr(length - n);
+    } else if (contiguousRecords(previousTail, record)) {
+        tail.text = previousTail.text + record.text;
+        tail.text.erase(0, std::max<long long>(0, tail.text.length() - n));
+    } else {
+        tail.text = record.text;
+    }
+    tail.name = record.name;
+    tail.position = record.position + length - tail.text.length();
+    tail.offset = record.offset + length - tail.text.length();
+    return tail;
+}
+
+/*
+    이어진 레코드의 경계에 걸친 매칭을 찾기 위한 이음 레코드를 만드는 함수
+    앞 레코드의 끝 (가장 긴 패턴 길이 - 1)개 염기와 다음 레코드의 앞 (가장 긴 패턴 길이 - 1)개 염기를 이어 붙인다.
+    @parameters
+    - tail: 앞 레코드의 끝부분 (recordTail)
+    - next: 다음 레코드
+    - maxPatternLength: 가장 긴 패턴 길이
+    @returns
+    - 이음 레코드 (두 레코드가 이어지지 않으면 text가 빈 레코드)
+*/
+SequenceRecord makeSeamRecord(const SequenceRecord& tail, const SequenceRecord& next, int maxPatternLength) {
+    SequenceRecord seam;
+    if (maxPatternLength < 2 || !contiguousRecords(tail, next)) return seam;
+    long long split = std::min<long long>(maxPatternLength - 1, tail.text.length());
+    seam.name = next.name;
+    seam.position = next.position - split;
+    seam.offset = next.offset - split;
+    seam.text = tail.text.substr(tail.text.length() - split) + next.text.substr(0, maxPatternLength - 1);
+    seam.seamSplit = split;
+    return seam;
+}
+
+/*
+    메모리에 유지된 레코드들 사이의 이음 레코드를 모두 만드는 함수
+    @parameters
+    - records: 레코드 (offset 순서)
+    - maxPatternLength: 가장 긴 패턴 길이
+*/
+std::vector<SequenceRecord> buildSeamRecords(const std::vector<SequenceRecord>& records, int maxPatternLength) {
+    std::vector<SequenceRecord> seams;
+    SequenceRecord tail;
+    for (const SequenceRecord& record : records) {
+        SequenceRecord seam = makeSeamRecord(tail, record, maxPatternLength);
+        if (!seam.text.empty()) seams.push_back(std::move(seam));
+        tail = recordTail(tail, record, maxPatternLength - 1);
+    }
+    return seams;
+}
+
+/*
+    스캐너가 결과 기록 단계로 넘기는 레코드별 매칭 결과
+    matches[p]는 패턴 p의 매칭 위치 (레코드 기준 위치)
+*/
+struct RecordResult {
+    SequenceRecord record;
+    std::vector<std::vector<long long>> matches;
+};
+
+/*
+    pread를 반복하여 요청한 길이만큼 읽는 함수
+    @returns
+    - 읽은 바이트 수 (오류 시 -1)
+*/
+long long preadFully(int fd, char* buffer, size_t length, long long offset) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t r = pread(fd, buffer + done, length - done, offset + done);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (r == 0) break; // 파일 끝
+        done += r;
+    }
+    return done;
+}
+
+/*
+    파일 블록을 비동기로 읽는 클래스
+    커널이 io_uring을 지원하면 여러 읽기 요청을 링에 한꺼번에 제출하고,
+    지원하지 않으면 std::async 스레드에서 pread를 수행한다.
+    완료 순서와 관계없이 waitNext()는 제출한 순서대로 블록을 돌려준다.
+*/
+class AsyncBlockReader {
+public:
+    explicit AsyncBlockReader(unsigned depth) {
+#ifdef AHO_HAVE_IO_URING
+        setupRing(depth);
+#else
+        (void)depth;
+#endif
+    }
+
+    ~AsyncBlockReader() {
+        // 진행 중인 요청이 버퍼를 사용하지 않도록 모두 회수
+        while (!requests.empty()) {
+            waitNext();
+        }
+#ifdef AHO_HAVE_IO_URING
+        if (ringFd >= 0) {
+            munmap(sqes, sqesSize);
+            if (cqPtr != sqPtr) munmap(cqPtr, cqSize);
+            munmap(sqPtr, sqSize);
+            close(ringFd);
+        }
+#endif
+    }
+
+    bool usingIoUring() const { return ringFd >= 0; }
+    size_t inFlight() const { return requests.size(); }
+
+    // fd의 offset 위치에서 length 바이트를 읽는 요청을 제출
+    void submit(int fd, long long offset, size_t length) {
+        requests.emplace_back();
+        Request& request = requests.back(); // deque는 push_back 시 기존 원소의 주소를 유지
+        request.fd = fd;
+        request.offset = offset;
+        request.data.resize(length);
+
+#ifdef AHO_HAVE_IO_URING
+        if (ringFd >= 0 && submitRingRead(request, nextId)) {
+            ++nextId;
+            return;
+        }
+#endif
+        char* buffer = &request.data[0];
+        request.future = std::async(std::launch::async, [fd, buffer, length, offset]() {
+            return preadFully(fd, buffer, length, offset);
+        });
+        ++nextId;
+    }
+
+    // 가장 먼저 제출한 요청이 완료될 때까지 기다린 후 데이터를 반환
+    std::string waitNext() {
+        Request& request = requests.front();
+        if (request.future.valid()) {
+            request.result = request.future.get();
+            request.done = true;
+        }
+#ifdef AHO_HAVE_IO_URING
+        while (!request.done) {
+            reapRingCompletion();
+        }
+#endif
+        // 짧은 읽기나 io_uring 오류(예: 오래된 커널의 IORING_OP_READ 미지원)는 pread로 마무리
+        long long got = std::max(request.result, 0LL);
+        if (got < (long long)request.data.size()) {
+            long long rest = preadFully(request.fd, &request.data[got], request.data.size() - got, request.offset + got);
+            if (rest < 0) {
+                std::cerr << "파일을 읽을 수 없습니다." << std::endl;
+                exit(1);
+            }
+            got += rest;
+        }
+        request.data.resize(got);
+
+        std::string data = std::move(request.data);
+        requests.pop_front();
+        ++frontId;
+        return data;
+    }
+
+private:
+    struct Request {
+        int fd = -1;
+        long long offset = 0;
+        std::string data;
+        std::future<long long> future; // 스레드 기반 읽기에서만 사용
+        bool done = false;
+        long long result = 0;
+    };
+
+    std::deque<Request> requests;   // 제출 순서대로 보관
+    unsigned long long nextId = 0;  // 다음에 제출할 요청 번호
+    unsigned long long frontId = 0; // requests.front()의 요청 번호
+    int ringFd = -1;
+
+#ifdef AHO_HAVE_IO_URING
+    void* sqPtr = nullptr;
+    void* cqPtr = nullptr;
+    size_t sqSize = 0, cqSize = 0, sqesSize = 0;
+    unsigned *sqTail = nullptr, *sqMask = nullptr, *sqArray = nullptr;
+    unsigned *cqHead = nullptr, *cqTail = nullptr, *cqMask = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    // io_uring 링을 생성하고 제출/완료 큐를 매핑. 실패하면 스레드 기반 읽기를 사용
+    void setupRing(unsigned depth) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        int fd = syscall(__NR_io_uring_setup, depth, &params);
+        if (fd < 0) return;
+
+        sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMmap) sqSize = cqSize = std::max(sqSize, cqSize);
+
+        sqPtr = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqPtr == MAP_FAILED) {
+            close(fd);
+            return;
+        }
+        cqPtr = singleMmap ? sqPtr
+                           : mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqesPtr = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (cqPtr == MAP_FAILED || sqesPtr == MAP_FAILED) {
+            if (cqPtr != MAP_FAILED && cqPtr != sqPtr) munmap(cqPtr, cqSize);
+            munmap(sqPtr, sqSize);
+            close(fd);
+            return;
+        }
+
+        char* sq = static_cast<char*>(sqPtr);
+        char* cq = static_cast<char*>(cqPtr);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        sqes = static_cast<io_uring_sqe*>(sqesPtr);
+        ringFd = fd;
+    }
+
+    // 읽기 요청 하나를 제출 큐에 넣고 커널에 알림
+    bool submitRingRead(Request& request, unsigned long long id) {
+        unsigned tail = __atomic_load_n(sqTail, __ATOMIC_ACQUIRE);
+        unsigned index = tail & *sqMask;
+        io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = request.fd;
+        sqe->addr = reinterpret_cast<unsigned long long>(&request.data[0]);
+        sqe->len = request.data.size();
+        sqe->off = request.offset;
+        sqe->user_data = id;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+        if (syscall(__NR_io_uring_enter, ringFd, 1, 0, 0, nullptr, 0) < 0) {
+            __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE); // 제출 실패 시 되돌리고 스레드 읽기로 처리
+            return false;
+        }
+        return true;
+    }
+
+    // 완료 큐에서 하나를 꺼내 해당 요청에 결과를 기록 (없으면 커널에서 대기)
+    void reapRingCompletion() {
+        unsigned head = __atomic_load_n(cqHead, __ATOMIC_RELAXED);
+        while (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+            syscall(__NR_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        }
+        io_uring_cqe* cqe = &cqes[head & *cqMask];
+        Request& request = requests[cqe->user_data - frontId];
+        request.result = cqe->res; // 음수는 -errno
+        request.done = true;
+        __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+    }
+#endif
+};
+
+/*
+    파일 확장자로 FASTA 파일 여부를 확인하는 함수 (압축 확장자 .gz, .bgz는 무시)
+*/
+bool isFastaFile(std::string fileName) {
+    for (const char* suffix : {".gz", ".bgz"}) {
+        size_t length = std::strlen(suffix);
+        if (fileName.size() > length && fileName.compare(fileName.size() - length, length, suffix) == 0) {
+            fileName.erase(fileName.size() - length);
+            break;
+        }
+    }
+    std::string extension;
+    size_t dotPos = fileName.find_last_of(".");
+    if (dotPos != std::string::npos) {
+        extension = fileName.substr(dotPos + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+    }
+    return extension == "fa" || extension == "fasta";
+}
+
+// 입력 파일의 압축 형식
+enum class Compression { NONE, GZIP, BGZF };
+
+/*
+    파일 앞부분의 gzip 헤더로 압축 형식을 확인하는 함수
+    BGZF는 FEXTRA 필드에 "BC" 하위 필드(블록 크기)가 있는 gzip 멤버들의 연속
+*/
+Compression detectCompression(int fd) {
+    unsigned char header[18] = {0};
+    long long headerLength = preadFully(fd, reinterpret_cast<char*>(header), sizeof(header), 0);
+    if (headerLength < 12 || header[0] != 0x1f || header[1] != 0x8b) {
+        return Compression::NONE;
+    }
+    // BGZF 헤더는 BSIZE까지 18바이트 (그보다 짧으면 일반 gzip으로 처리)
+    if (headerLength >= static_cast<long long>(sizeof(header)) &&
+        (header[3] & 4) && header[10] == 6 && header[11] == 0 &&
+        header[12] == 'B' && header[13] == 'C' && header[14] == 2 && header[15] == 0) {
+        return Compression::BGZF;
+    }
+    return Compression::GZIP;
+}
+
+/*
+    파일 전체를 READ_BLOCK_SIZE 블록으로 비동기 읽기하며 순서대로 consume에 넘기는 함수
+    한 블록을 넘기는 동안 다음 READ_DEPTH개의 블록이 이미 읽히고 있다.
+*/
+void readFileBlocks(AsyncBlockReader& reader, int fd, long long fileSize,
+                    const std::function<void(std::string&&)>& consume) {
+    long long numBlocks = (fileSize + READ_BLOCK_SIZE - 1) / READ_BLOCK_SIZE;
+    long long submitted = 0;
+    for (long long emitted = 0; emitted < numBlocks; ++emitted) {
+        // 읽기 요청을 READ_DEPTH개까지 미리 제출
+        while (reader.inFlight() < READ_DEPTH && submitted < numBlocks) {
+            long long offset = submitted * READ_BLOCK_SIZE;
+            reader.submit(fd, offset, std::min<long long>(READ_BLOCK_SIZE, fileSize - offset));
+            ++submitted;
+        }
+        consume(reader.waitNext());
+    }
+}
+
+#ifdef AHO_HAVE_ZLIB
+/*
+    data에서 시작하는 BGZF 블록의 전체 크기를 반환하는 함수
+    @returns
+    - 블록 크기 (available 안에 블록이 다 들어 있지 않으면 0, BGZF 블록이 아니면 -1)
+*/
+long long bgzfBlockSize(const unsigned char* data, size_t available) {
+    if (available >= 2 && (data[0] != 0x1f || data[1] != 0x8b)) return -1; // gzip 매직 번호가 아님
+    if (available < 18) return 0;
+    if (data[0] != 0x1f || data[1] != 0x8b || !(data[3] & 4) || data[12] != 'B' || data[13] != 'C') return -1;
+    long long size = (data[16] | (data[17] << 8)) + 1;
+    return static_cast<long long>(available) >= size ? size : 0;
+}
+
+/*
+    BGZF 블록들을 여러 스레드에서 병렬로 압축 해제하는 함수
+    각 블록의 꼬리에 압축 해제 크기(ISIZE)가 있으므로 출력 위치를 미리 정하고,
+    블록을 스레드 수만큼 연속 구간으로 나누어 각 스레드가 출력 버퍼의 자기 위치에 바로 압축 해제
+    @parameters
+    - data: BGZF 블록들이 이어진 압축 데이터
+    - blocks: 블록별 (시작 위치, 크기)
+    - output: 압축 해제된 데이터를 저장할 문자열
+    @returns
+    - 성공 여부 (손상된 블록이나 CRC 불일치가 있으면 false)
+*/
+bool inflateBgzfBlocks(const std::string& data, const std::vector<std::pair<size_t, size_t>>& blocks,
+                       std::string& output) {
+    auto footer = [&](size_t end, int back) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data()) + end - back;
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    };
+
+    std::vector<size_t> outOffsets(blocks.size() + 1, 0);
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        outOffsets[b + 1] = outOffsets[b] + footer(blocks[b].first + blocks[b].second, 4);
+    }
+    output.resize(outOffsets.back());
+
+    auto inflateRange = [&](size_t first, size_t last) {
+        ScopedPhase span("bgzf_inflate", "task");
+        z_stream stream;
+        std::memset(&stream, 0, sizeof(stream));
+        if (inflateInit2(&stream, -15) != Z_OK) return false; // 헤더 없는 deflate 데이터
+        bool ok = true;
+        for (size_t b = first; b < last && ok; ++b) {
+            const unsigned char* block = reinterpret_cast<const unsigned char*>(data.data()) + blocks[b].first;
+            size_t headerSize = 12 + (block[10] | (block[11] << 8));
+            unsigned char* out = reinterpret_cast<unsigned char*>(&output[0]) + outOffsets[b];
+            size_t outSize = outOffsets[b + 1] - outOffsets[b];
+
+            inflateReset(&stream);
+            stream.next_in = const_cast<unsigned char*>(block + headerSize);
+            stream.avail_in = blocks[b].second - headerSize - 8;
+            stream.next_out = out;
+            stream.avail_out = outSize;
+            ok = inflate(&stream, Z_FINISH) == Z_STREAM_END && stream.avail_out == 0 &&
+                 crc32(0L, out, outSize) == footer(blocks[b].first + blocks[b].second, 8);
+        }
+        inflateEnd(&stream);
+        return ok;
+    };
+
+    unsigned numThreads = std::max<size_t>(1, std::min<size_t>(NUM_THREADS, blocks.size()));
+    std::vector<std::future<bool>> parts;
+    for (unsigned t = 1; t < numThreads; ++t) {
+        parts.push_back(std::async(std::launch::async, inflateRange,
+                                   blocks.size() * t / numThreads, blocks.size() * (t + 1) / numThreads));
+    }
+    bool ok = inflateRange(0, blocks.size() / numThreads);
+    for (auto& part : parts) {
+        ok = part.get() && ok;
+    }
+    return ok;
+}
+
+/*
+    마지막 gzip 멤버 뒤에 붙은 데이터를 검사하는 함수
+    gzip처럼 0으로 채운 부분(테이프/블록 단위 패딩)은 조용히 무시하고, 그 밖의 데이터는 경고 후 무시
+    @parameters
+    - data: 마지막 멤버 뒤의 데이터
+    - length: data의 길이
+    @returns
+    - 0이 아닌 바이트가 있으면 true
+*/
+bool hasTrailingGarbage(const char* data, size_t length) {
+    return std::any_of(data, data + length, [](char c) { return c != 0; });
+}
+
+/*
+    BGZF 파일을 읽는 함수
+    읽은 블록에서 완전한 BGZF 블록들을 찾아 병렬로 압축 해제하고, 블록 경계에 걸친 나머지는 다음 읽기와 합침
+    gzip 매직 번호로 시작하지 않는 데이터가 나오면 그 뒤는 모두 파일 끝의 패딩으로 보고 무시
+*/
+void loadBgzfFile(AsyncBlockReader& reader, int fd, long long fileSize, int fileIndex,
+                  const std::string& path, BoundedQueue<RawBlock>& out) {
+    std::string pending;          // 아직 압축 해제하지 않은 데이터
+    bool trailing = false;        // 마지막 블록 뒤의 데이터를 읽는 중인지 여부
+    bool trailingGarbage = false; // 그 데이터에 0이 아닌 바이트가 있었는지 여부
+    readFileBlocks(reader, fd, fileSize, [&](std::string&& data) {
+        if (trailing) {
+            trailingGarbage = trailingGarbage || hasTrailingGarbage(data.data(), data.size());
+            return;
+        }
+        if (pending.empty()) {
+            pending = std::move(data);
+        } else {
+            pending += data;
+        }
+
+        std::vector<std::pair<size_t, size_t>> blocks;
+        size_t pos = 0;
+        while (true) {
+            long long size = bgzfBlockSize(reinterpret_cast<const unsigned char*>(pending.data()) + pos,
+                                           pending.size() - pos);
+            if (size < 0) {
+                if (static_cast<unsigned char>(pending[pos]) == 0x1f &&
+                    static_cast<unsigned char>(pending[pos + 1]) == 0x8b) {
+                    std::cerr << "손상된 BGZF 파일입니다: " << path << std::endl;
+                    exit(1);
+                }
+                trailing = true;
+                trailingGarbage = hasTrailingGarbage(pending.data() + pos, pending.size() - pos);
+                pending.resize(pos);
+                break;
+            }
+            if (size == 0) break;
+            blocks.emplace_back(pos, size);
+            pos += size;
+        }
+
+        RawBlock block{fileIndex, std::string(), false};
+        if (!inflateBgzfBlocks(pending, blocks, block.data)) {
+            std::cerr << "BGZF 블록을 압축 해제할 수 없습니다: " << path << std::endl;
+            exit(1);
+        }
+        pending.erase(0, pos);
+        if (!block.data.empty()) {
+            out.push(std::move(block));
+        }
+    });
+
+    // 매직 번호를 확인할 수 없는 1바이트 나머지도 파일 끝의 데이터
+    if (pending.size() == 1) {
+        trailingGarbage = trailingGarbage || pending[0] != 0;
+    } else if (!pending.empty()) {
+        std::cerr << "BGZF 파일이 중간에 끝났습니다: " << path << std::endl;
+        exit(1);
+    }
+    if (trailingGarbage) {
+        std::cerr << "경고: 압축 파일 끝의 알 수 없는 데이터를 무시합니다: " << path << std::endl;
+    }
+}
+
+/*
+    일반 gzip 파일을 읽는 함수
+    gzip 스트림은 블록 단위로 나눌 수 없으므로 한 스레드에서 순차적으로 압축 해제 (여러 멤버로 된 파일 지원)
+    멤버가 끝난 뒤 남은 데이터가 gzip 매직 번호로 시작할 때만 다음 멤버로 읽고, 아니면 파일 끝의 패딩으로 보고 무시
+*/
+void loadGzipFile(AsyncBlockReader& reader, int fd, long long fileSize, int fileIndex,
+                  const std::string& path, BoundedQueue<RawBlock>& out) {
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+        std::cerr << "gzip 압축 해제를 시작할 수 없습니다: " << path << std::endl;
+        exit(1);
+    }
+
+    std::string buffer(READ_BLOCK_SIZE, '\0');
+    size_t used = 0;
+    bool memberEnded = false;
+    bool trailing = false;        // 마지막 멤버 뒤의 데이터를 읽는 중인지 여부
+    bool trailingGarbage = false; // 그 데이터에 0이 아닌 바이트가 있었는지 여부
+    std::string carry;            // 매직 번호를 확인하려고 다음 읽기로 넘긴 1바이트
+    readFileBlocks(reader, fd, fileSize, [&](std::string&& data) {
+        ScopedPhase phase("gzip_inflate");
+        if (!carry.empty()) {
+            data.insert(0, carry);
+            carry.clear();
+        }
+        stream.next_in = reinterpret_cast<unsigned char*>(&data[0]);
+        stream.avail_in = data.size();
+        while (stream.avail_in > 0) {
+            if (trailing) {
+                const char* rest = reinterpret_cast<const char*>(stream.next_in);
+                trailingGarbage = trailingGarbage || hasTrailingGarbage(rest, stream.avail_in);
+                break;
+            }
+            if (memberEnded) {
+                if (stream.avail_in < 2) {
+                    carry.assign(reinterpret_cast<const char*>(stream.next_in), stream.avail_in);
+                    break;
+                }
+                if (stream.next_in[0] != 0x1f || stream.next_in[1] != 0x8b) {
+                    trailing = true;
+                    continue;
+                }
+                inflateReset(&stream); // 다음 gzip 멤버
+                memberEnded = false;
+            }
+            stream.next_out = reinterpret_cast<unsigned char*>(&buffer[used]);
+            stream.avail_out = buffer.size() - used;
+            int status = inflate(&stream, Z_NO_FLUSH);
+            used = buffer.size() - stream.avail_out;
+            if (status == Z_STREAM_END) {
+                memberEnded = true;
+            } else if (status != Z_OK && status != Z_BUF_ERROR) {
+                std::cerr << "gzip 파일을 압축 해제할 수 없습니다: " << path << std::endl;
+                exit(1);
+            }
+
+            // 출력 버퍼가 차면 패커로 넘김
+            if (used == buffer.size()) {
+                out.push(RawBlock{fileIndex, std::move(buffer), false});
+                buffer.assign(READ_BLOCK_SIZE, '\0');
+                used = 0;
+            }
+        }
+    });
+    inflateEnd(&stream);
+
+    if (!memberEnded) {
+        std::cerr << "gzip 파일이 중간에 끝났습니다: " << path << std::endl;
+        exit(1);
+    }
+    if (!carry.empty()) {
+        trailingGarbage = trailingGarbage || carry[0] != 0;
+    }
+    if (trailingGarbage) {
+        std::cerr << "경고: 압축 파일 끝의 알 수 없는 데이터를 무시합니다: " << path << std::endl;
+    }
+    if (used > 0) {
+        buffer.resize(used);
+        out.push(RawBlock{fileIndex, std::move(buffer), false});
+    }
+}
+#endif
+
+/*
+    로더 단계: 입력 파일들을 블록 단위로 비동기 읽기하여 패커에 전달
+    gzip으로 압축된 파일은 읽으면서 압축 해제하며, BGZF 파일은 블록들을 여러 스레드에서 병렬로 압축 해제
+    @parameters
+    - inputs: 읽을 파일 목록
+    - out: 패커로 가는 큐
+*/
+void loaderStage(const std::vector<InputFile>& inputs, BoundedQueue<RawBlock>& out) {
+    AsyncBlockReader reader(READ_DEPTH);
+
+    for (size_t f = 0; f < inputs.size(); ++f) {
+        ScopedPhase phase("load", "phase", inputs[f].path);
+        int fd = open(inputs[f].path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            std::cerr << "파일을 열 수 없습니다: " << inputs[f].path << std::endl;
+            exit(1);
+        }
+
+        Compression compression = detectCompression(fd);
+        if (compression == Compression::NONE) {
+            readFileBlocks(reader, fd, st.st_size, [&](std::string&& data) {
+                out.push(RawBlock{static_cast<int>(f), std::move(data), false});
+            });
+        } else {
+#ifdef AHO_HAVE_ZLIB
+            if (compression == Compression::BGZF) {
+                loadBgzfFile(reader, fd, st.st_size, f, inputs[f].path, out);
+            } else {
+                loadGzipFile(reader, fd, st.st_size, f, inputs[f].path, out);
+            }
+#else
+            std::cerr << "zlib 없이 빌드되어 압축된 파일을 읽을 수 없습니다: " << inputs[f].path << std::endl;
+            exit(1);
+#endif
+        }
+
+        close(fd);
+        out.push(RawBlock{static_cast<int>(f), std::string(), true});
+    }
+
+    out.close();
+}
+
+/*
+    패커 단계: 원시 블록을 레코드 단위의 서열로 정리하여 스캐너에 전달
+    FASTA 파일은 헤더 라인(>)을 기준으로 레코드를 나누고, 모든 파일에서 공백 문자를 제거
+    @parameters
+    - inputs: 입력 파일 목록 (FASTA 여부 및 레코드 이름, 위치 결정용)
+    - in: 로더에서 오는 큐
+    - out: 스캐너로 가는 큐
+*/
+void packerStage(const std::vector<InputFile>& inputs, BoundedQueue<RawBlock>& in,
+                 BoundedQueue<SequenceRecord>& out) {
+    long long offset = 0;       // 다음 레코드의 시작 위치
+    int currentFile = -1;       // 현재 처리 중인 파일
+    bool fasta = false;
+    bool lineStart = true;      // 현재 문자가 라인의 첫 문자인지 여부
+    bool inHeader = false;      // FASTA 헤더 라인을 읽는 중인지 여부
+    std::string header;
+    SequenceRecord current;
+
+    // 새 레코드의 기본 이름과 위치 (FASTA 헤더가 나오면 헤더 이름으로 바뀜)
+    auto startRecord = [&]() {
+        const InputFile& input = inputs[currentFile];
+        current = SequenceRecord();
+        current.name = input.label.empty() ? input.path : input.label;
+        current.position = input.start;
+    };
+
+    // 완성된 레코드를 스캐너로 넘김 (빈 레코드는 버림)
+    auto emit = [&]() {
+        if (!current.text.empty()) {
+            current.offset = offset;
+            offset += current.text.length();
+            out.push(std::move(current));
+        }
+        startRecord();
+    };
+
+    RawBlock block;
+    while (in.pop(block)) {
+        ScopedPhase phase("pack");
+        if (block.fileIndex != currentFile) {
+            currentFile = block.fileIndex;
+            fasta = isFastaFile(inputs[currentFile].path);
+            lineStart = true;
+            inHeader = false;
+            startRecord();
+        }
+        if (block.endOfFile) {
+            emit();
+            currentFile = -1;
+            continue;
+        }
+
+        for (char c : block.data) {
+            if (inHeader) {
+                if (c == '\n') {
+                    // 헤더의 첫 단어를 레코드 이름으로 사용
+                    size_t end = header.find_first_of(" \t\r");
+                    current.name = header.substr(0, end);
+                    current.position = 0;
+                    inHeader = false;
+                    lineStart = true;
+                } else {
+                    header += c;
+                }
+                continue;
+            }
+            if (fasta && lineStart && c == '>') {
+                emit();
+                inHeader = true;
+                header.clear();
+                continue;
+            }
+            lineStart = (c == '\n');
+            if (!std::isspace(static_cast<unsigned char>(c))) {
+                current.text += c;
+            }
+        }
+    }
+
+    out.close();
+}
+
+/*
+    워커 풀에 제출된 레코드 하나의 검색 상태
+    레코드의 (패턴, 청크) 작업이 모두 끝나면 remainingTasks가 0이 되고 finished로 알린다.
+    record는 검색이 끝날 때까지 호출한 쪽에서 유지해야 함
+*/
+struct RecordScanJob {
+    const SequenceRecord* record = nullptr;
+    TrieNode* root = nullptr;
+    int d = 0;
+    std::vector<std::string> patterns;              // 검색할 패턴
+    std::shared_ptr<const KmerProbeTable> kmerTable; // 있으면 청크마다 모든 패턴을 한 번에 검색
+    OutputMode mode;
+    std::shared_ptr<std::vector<std::atomic<bool>>> found; // 전체 패턴별 발견 여부 (EXISTS, 레코드 사이에 공유)
+    std::vector<MatchCollector> collected;          // 패턴별 매칭 수집기 (레코드 기준 위치)
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    long long remainingTasks = 0;
+
+    // 결과 캐시 관련 정보 (beginRecordScan에서 사용)
+    std::vector<int> slots;                         // patterns[j]의 전체 패턴 리스트에서의 인덱스
+    std::vector<std::vector<long long>> results;    // 전체 패턴별 매칭 위치 (캐시 적중 포함)
+    std::vector<char> cached;                       // patterns[j]가 캐시에 적중했는지 여부 (k-mer 엔진에서만 적중 패턴을 남김)
+    std::string chunkDigest;
+
+    // patterns[j]의 발견 여부 플래그 (EXISTS 모드가 아니면 nullptr)
+    std::atomic<bool>* foundFlag(int j) {
+        return found ? &(*found)[slots[j]] : nullptr;
+    }
+
+    // patterns[j]의 결과를 이미 캐시에서 얻었는지 여부 (작업에서 건너뜀)
+    bool fromCache(int j) const {
+        return !cached.empty() && cached[j];
+    }
+};
+
+/*
+    프로그램 전체에서 공유하는 검색 워커 풀
+    여러 레코드(파일, FASTA 레코드)의 (패턴, 청크) 작업을 하나의 작업 큐에 모아 처리하므로,
+    한 레코드의 마지막 작업을 기다리는 동안에도 다음 레코드의 작업이 진행된다.
+*/
+class ScanWorkerPool {
+public:
+    explicit ScanWorkerPool(unsigned numThreads) {
+        for (unsigned t = 0; t < numThreads; ++t) {
+            threads.emplace_back(&ScanWorkerPool::workerLoop, this);
+        }
+    }
+
+    ~ScanWorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            stopping = true;
+        }
+        available.notify_all();
+        for (auto& th : threads) {
+            th.join();
+        }
+    }
+
+    /*
+        레코드를 청크로 나누어 (패턴, 청크) 작업을 작업 큐에 넣는 함수
+        각 청크는 그 안에서 시작하는 매칭만 담당하도록 패턴마다 자기 길이 - 1만큼만 다음 청크와 겹치고,
+        짧은 레코드는 하나의 청크로 처리
+        k-mer 엔진을 사용하면 청크마다 모든 패턴을 검색하는 작업 하나만 넣음 (패턴 인덱스 -1, 가장 긴 패턴 기준으로 겹침)
+        각 작업은 [start_pos, owned_end)에서 시작하는 매칭만 담당
+    */
+    void submit(const std::shared_ptr<RecordScanJob>& job) {
+        const std::string& text = job->record->text;
+        int numPatterns = job->patterns.size();
+        int patternLength = 0;
+        for (const std::string& pattern : job->patterns) {
+            patternLength = std::max<int>(patternLength, pattern.length());
+        }
+
+        int passes = job->kmerTable ? 1 : numPatterns;
+        long long text_length = text.length();
+        long long split = job->record->seamSplit;
+        int NUM_CHUNKS = (split > 0 || text_length / 30 < patternLength) ? 1 : 30;
+        long long chunk_size = text_length / NUM_CHUNKS;
+
+        job->collected.clear();
+        for (int j = 0; j < numPatterns; ++j) {
+            job->collected.emplace_back(job->mode, job->foundFlag(j));
+        }
+        std::vector<Task> jobTasks;
+        long long work = 0;
+        for (int p = 0; p < passes; ++p) {
+            long long overlap = (job->kmerTable ? patternLength : job->patterns[p].length()) - 1;
+            for (int c = 0; c < NUM_CHUNKS; ++c) {
+                long long start_pos = c * chunk_size;
+                long long owned_end = (c == NUM_CHUNKS - 1) ? text_length : (start_pos + chunk_size);
+                if (split > 0) {
+                    // 이음 레코드: 앞 레코드에서 시작해 다음 레코드에서 끝나는 매칭만 찾음
+                    start_pos = std::max(0LL, split - overlap);
+                    owned_end = split;
+                }
+                long long end_pos = std::min(text_length, owned_end + overlap);
+                if (end_pos - start_pos <= overlap) continue; // 패턴이 들어갈 수 없는 구간
+                jobTasks.push_back(Task{job, job->kmerTable ? -1 : p, start_pos, end_pos, owned_end});
+                work += end_pos - start_pos;
+            }
+        }
+        job->remainingTasks = jobTasks.size();
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            tasks.insert(tasks.end(), jobTasks.begin(), jobTasks.end());
+        }
+        // 전체 작업량에 이 레코드의 작업량 추가
+        total_work += work;
+        available.notify_all();
+    }
+
+    // 레코드의 모든 작업이 끝날 때까지 대기
+    void wait(RecordScanJob& job) {
+        std::unique_lock<std::mutex> lock(job.mutex);
+        job.finished.wait(lock, [&]() { return job.remainingTasks == 0; });
+    }
+
+private:
+    struct Task {
+        std::shared_ptr<RecordScanJob> job;
+        int patternIndex;
+        long long start_pos;
+        long long end_pos;
+        long long owned_end;    // 이 위치 이전에 시작하는 매칭만 이 작업의 결과 (겹침 구간의 매칭이 중복되지 않도록)
+    };
+
+    std::vector<std::thread> threads;
+    std::deque<Task> tasks;             // 작업 큐 (queue_mutex로 보호)
+    std::condition_variable available;  // 작업이 들어오거나 풀이 종료될 때 알림
+    bool stopping = false;
+
+    void workerLoop() {
+        while (true) {
+            Task task;
+            // 작업 큐에서 작업 가져오기
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                available.wait(lock, [&]() { return stopping || !tasks.empty(); });
+                if (stopping) break;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+
+            RecordScanJob& job = *task.job;
+            if (task.patternIndex < 0) {
+                runKmerTask(task);
+            } else {
+                runPatternTask(task);
+            }
+
+            // 완료 알림
+            std::lock_guard<std::mutex> lock(job.mutex);
+            if (--job.remainingTasks == 0) {
+                job.finished.notify_all();
+            }
+        }
+    }
+
+    // 패턴 하나를 청크 하나에서 검색 (특수화된 커널이 있으면 사용)
+    static void runPatternTask(const Task& task) {
+        RecordScanJob& job = *task.job;
+        std::atomic<bool>* found = job.foundFlag(task.patternIndex);
+        if (found && found->load(std::memory_order_relaxed)) {
+            // 다른 작업에서 이미 찾은 패턴 (EXISTS)
+            total_processed += task.end_pos - task.start_pos;
+            return;
+        }
+
+        const std::string& text = job.record->text;
+        const std::string& pattern = job.patterns[task.patternIndex];
+        ScopedPhase span("scan_task", "task", profiler.isEnabled() ? job.record->name + " " + pattern : std::string(),
+                         job.record->name);
+
+        // end_pos가 owned_end + 패턴 길이 - 1이므로 owned_end 이후에 시작하는 매칭은 나오지 않음
+        MatchCollector collector(job.mode, found);
+        if (SearchKernel kernel = selectSpecializedKernel(pattern.length(), job.d)) {
+            kernel(text, pattern, task.start_pos, task.end_pos, job.record->offset, collector);
+        } else {
+            aho_corasick_search_approx(text, job.root, pattern, job.d, task.start_pos, task.end_pos,
+                                       job.record->offset, collector);
+        }
+
+        std::lock_guard<std::mutex> lock(job.mutex);
+        job.collected[task.patternIndex].merge(std::move(collector));
+    }
+
+    // k-mer 엔진: 청크 하나에서 모든 패턴을 한 번에 검색
+    static void runKmerTask(const Task& task) {
+        RecordScanJob& job = *task.job;
+        const KmerProbeTable& table = *job.kmerTable;
+        const std::string& text = job.record->text;
+        long long text_offset = job.record->offset;
+        long long split = job.record->seamSplit;
+        OutputKind kind = job.mode.kind;
+        bool countOnly = kind == OutputKind::COUNT || kind == OutputKind::EXISTS;
+
+        if (kind == OutputKind::EXISTS) {
+            // 모든 패턴을 이미 찾았으면 건너뜀
+            bool allFound = true;
+            for (size_t j = 0; j < job.patterns.size() && allFound; ++j) {
+                std::atomic<bool>* found = job.foundFlag(j);
+                allFound = found && found->load(std::memory_order_relaxed);
+            }
+            if (allFound) {
+                total_processed += task.end_pos - task.start_pos;
+                return;
+            }
+        }
+
+        // COUNT, EXISTS는 패턴별 개수만, 나머지는 (패턴, 오차 수, 위치)를 모음
+        std::vector<long long> counts;
+        std::vector<std::tuple<int, int, long long>> hits;
+        if (countOnly) counts.assign(job.patterns.size(), 0);
+        {
+            ScopedPhase span("kmer_task", "task", profiler.isEnabled() ? job.record->name : std::string(),
+                             job.record->name);
+            table.search(text, task.start_pos, task.end_pos, [&](int p, long long matchIndex, uint64_t diff) {
+                if (job.fromCache(p)) return; // 결과를 캐시에서 얻은 패턴
+                if (matchIndex >= task.owned_end) return; // 가장 긴 패턴보다 짧은 패턴의 매칭은 다음 청크에서 찾음
+                if (matchIndex + table.patternLength(p) <= split) return; // 이음 레코드: 앞 레코드 안의 매칭
+                if (countOnly) {
+                    counts[p]++;
+                    return;
+                }
+                hits.emplace_back(p, KmerProbeTable::mismatchCount(diff), matchIndex);
+                if (kind == OutputKind::FULL) table.markSnps(p, matchIndex, diff, text_offset);
+            });
+        }
+
+        std::lock_guard<std::mutex> lock(job.mutex);
+        for (size_t p = 0; p < counts.size(); ++p) {
+            if (counts[p] > 0) job.collected[p].addCount(counts[p]);
+        }
+        for (const auto& hit : hits) {
+            job.collected[std::get<0>(hit)].add(std::get<2>(hit), std::get<1>(hit));
+        }
+    }
+};
+
+/*
+    공유 워커 풀을 반환하는 함수 (처음 호출할 때 하드웨어 스레드 수만큼 생성)
+*/
+ScanWorkerPool& scanPool() {
+    static ScanWorkerPool pool(std::max(1u, NUM_THREADS));
+    return pool;
+}
+
+// 검색 엔진의 결과 형식이나 매칭 규칙이 바뀌면 증가시켜 이전 캐시 항목을 무효화
+// 1: 결과 캐시 도입 (일반 커널)
+// 2: 특수화된 커널 (m, d 조합별로 비트 병렬 커널이 매칭을 보고)
+const int ENGINE_VERSION = 2;
+
+/*
+    64비트 값을 섞는 함수 (splitmix64의 마무리 단계)
+*/
+uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/*
+    문자열의 128비트 콘텐츠 해시를 16진수 문자열로 반환하는 함수
+    8바이트 단위로 서로 다른 두 개의 곱셈-혼합 해시를 계산 (암호학적 해시는 아님)
+    @parameters
+    - data: 해시할 문자열
+    @returns
+    - 32자리 16진수 문자열
+*/
+std::string contentDigest(const std::string& data) {
+    uint64_t h1 = 0x9E3779B97F4A7C15ULL ^ data.length();
+    uint64_t h2 = 0xC2B2AE3D27D4EB4FULL + data.length();
+    size_t i = 0;
+    for (; i + 8 <= data.length(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data.data() + i, 8);
+        h1 = (h1 ^ word) * 0x100000001B3ULL;
+        h1 ^= h1 >> 29;
+        h2 = (h2 + word) * 0xFF51AFD7ED558CCDULL;
+        h2 ^= h2 >> 32;
+    }
+    for (; i < data.length(); ++i) {
+        h1 = (h1 ^ static_cast<unsigned char>(data[i])) * 0x100000001B3ULL;
+        h2 = (h2 + static_cast<unsigned char>(data[i])) * 0xFF51AFD7ED558CCDULL;
+    }
+
+    char hex[33];
+    snprintf(hex, sizeof(hex), "%016llx%016llx",
+             static_cast<unsigned long long>(mix64(h1)), static_cast<unsigned long long>(mix64(h2 ^ h1)));
+    return hex;
+}
+
+/*
+    패턴별 매칭 위치에서 SNP 위치(텍스트와 패턴이 다른 위치)를 모으는 함수
+    @parameters
+    - text: 레코드 문자열
+    - pattern: 패턴 문자열
+    - matches: 패턴의 매칭 위치 (text 기준 위치)
+    @returns
+    - SNP 위치 (text 기준 위치)
+*/
+std::vector<long long> collectSnpPositions(const std::string& text, const std::string& pattern,
+                                           const std::vector<long long>& matches) {
+    std::vector<long long> snps;
+    for (long long matchIndex : matches) {
+        for (size_t k = 0; k < pattern.length(); ++k) {
+            if (text[matchIndex + k] != pattern[k]) {
+                snps.push_back(matchIndex + k);
+            }
+        }
+    }
+    return snps;
+}
+
+/*
+    디스크에 저장되는 콘텐츠 주소 기반 결과 캐시
+    (레코드 해시, 패턴, d, 엔진 버전)을 키로 패턴의 매칭 위치와 SNP 위치를 저장한다.
+    위치는 레코드 기준으로 저장하므로 같은 내용의 청크라면 파일 이름이나 순서가 달라도 재사용된다.
+
+    여러 프로세스가 동시에 사용해도 안전하도록
+    - 항목은 임시 파일에 쓴 뒤 rename으로 한 번에 교체하고,
+    - 읽기는 잠금 없이 수행하며 (삭제된 항목은 미스로 처리),
+    - 크기 제한에 따른 삭제만 디렉토리 잠금 파일(flock)로 한 프로세스씩 수행한다.
+*/
+class ResultCache {
+public:
+    long long hits = 0;   // 캐시 적중 수
+    long long misses = 0; // 캐시 미스 수
+
+    ResultCache(const std::string& directory, long long maxBytes) : directory(directory), maxBytes(maxBytes) {
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if (ec) {
+            std::cerr << "캐시 디렉토리를 만들 수 없습니다: " << directory << std::endl;
+            exit(1);
+        }
+    }
+
+    /*
+        캐시에서 항목을 찾는 함수
+        @returns
+        - 항목이 있으면 true, matches와 snps에 저장된 값을 채움
+    */
+    bool lookup(const std::string& chunkDigest, long long chunkLength, const std::string& pattern, int d,
+                std::vector<long long>& matches, std::vector<long long>& snps) {
+        std::string path = entryPath(chunkDigest, pattern, d);
+        std::ifstream entry(path);
+        if (entry && readEntry(entry, chunkDigest, chunkLength, pattern, d, matches, snps)) {
+            // 최근 사용 시각 갱신 (크기 제한 시 LRU 순서로 삭제)
+            std::error_code ec;
+            std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+            hits++;
+            return true;
+        }
+        matches.clear();
+        snps.clear();
+        misses++;
+        return false;
+    }
+
+    /*
+        항목을 캐시에 저장하는 함수
+        임시 파일에 모두 쓴 뒤 rename하므로 다른 프로세스는 완성된 항목만 보게 된다.
+    */
+    void store(const std::string& chunkDigest, long long chunkLength, const std::string& pattern, int d,
+               const std::vector<long long>& matches, const std::vector<long long>& snps) {
+        std::string path = entryPath(chunkDigest, pattern, d);
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+        std::ostringstream tempName;
+        tempName << path << "." << getpid() << "." << tempCounter++ << ".tmp";
+        std::string tempPath = tempName.str();
+        {
+            std::ofstream entry(tempPath);
+            if (!entry) return; // 캐시에 쓰지 못해도 검색 결과에는 영향 없음
+            entry << "AHO-CACHE " << ENGINE_VERSION << "\n"
+                  << chunkDigest << " " << chunkLength << " " << d << " " << pattern << "\n";
+            writeList(entry, matches);
+            writeList(entry, snps);
+            if (!entry) {
+                entry.close();
+                std::filesystem::remove(tempPath, ec);
+                return;
+            }
+        }
+        std::filesystem::rename(tempPath, path, ec);
+        if (ec) std::filesystem::remove(tempPath, ec);
+    }
+
+    /*
+        캐시 크기가 제한을 넘으면 오래 사용하지 않은 항목부터 제한의 90%가 될 때까지 삭제하는 함수
+        잠금 파일로 삭제 작업만 직렬화하며, 다른 프로세스의 읽기/쓰기는 계속 진행될 수 있다.
+    */
+    void evict() {
+        std::string lockPath = directory + "/.lock";
+        int lockFd = open(lockPath.c_str(), O_RDWR | O_CREAT, 0644);
+        if (lockFd < 0) return;
+        flock(lockFd, LOCK_EX);
+
+        struct Entry {
+            std::filesystem::file_time_type lastUsed;
+            long long size;
+            std::filesystem::path path;
+        };
+        std::vector<Entry> entries;
+        long long totalSize = 0;
+        std::error_code ec;
+        for (auto it = std::filesystem::recursive_directory_iterator(directory, ec);
+             !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (!it->is_regular_file(ec) || it->path().filename() == ".lock") continue;
+            Entry entry{it->last_write_time(ec), static_cast<long long>(it->file_size(ec)), it->path()};
+            if (ec) continue; // 다른 프로세스가 방금 삭제한 항목
+            totalSize += entry.size;
+            entries.push_back(entry);
+        }
+
+        if (totalSize > maxBytes) {
+            std::sort(entries.begin(), entries.end(),
+                      [](const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+            long long target = maxBytes / 10 * 9;
+            for (const Entry& entry : entries) {
+                if (totalSize <= target) break;
+                if (std::filesystem::remove(entry.path, ec)) {
+                    totalSize -= entry.size;
+                }
+            }
+        }
+
+        flock(lockFd, LOCK_UN);
+        close(lockFd);
+    }
+
+private:
+    std::string directory;
+    long long maxBytes;
+    unsigned long long tempCounter = 0;
+
+    // 키로부터 항목 경로 생성 (디렉토리 하나에 파일이 몰리지 않도록 앞 두 글자로 나눔)
+    std::string entryPath(const std::string& chunkDigest, const std::string& pattern, int d) const {
+        std::ostringstream key;
+        key << chunkDigest << " " << d << " " << ENGINE_VERSION << " " << pattern;
+        std::string digest = contentDigest(key.str());
+        return directory + "/" + digest.substr(0, 2) + "/" + digest.substr(2);
+    }
+
+    static void writeList(std::ostream& out, const std::vector<long long>& values) {
+        out << values.size();
+        for (long long value : values) {
+            out << " " << value;
+        }
+        out << "\n";
+    }
+
+    static bool readList(std::istream& in, std::vector<long long>& values) {
+        size_t count;
+        if (!(in >> count)) return false;
+        values.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            if (!(in >> values[i])) return false;
+        }
+        return true;
+    }
+
+    // 항목을 읽고 헤더가 키와 일치하는지 확인 (해시 충돌 방지)
+    static bool readEntry(std::istream& in, const std::string& chunkDigest, long long chunkLength,
+                          const std::string& pattern, int d,
+                          std::vector<long long>& matches, std::vector<long long>& snps) {
+        std::string magic, storedDigest, storedPattern;
+        int version, storedD;
+        long long storedLength;
+        if (!(in >> magic >> version >> storedDigest >> storedLength >> storedD >> storedPattern)) return false;
+        if (magic != "AHO-CACHE" || version != ENGINE_VERSION || storedDigest != chunkDigest ||
+            storedLength != chunkLength || storedD != d || storedPattern != pattern) {
+            return false;
+        }
+        return readList(in, matches) && readList(in, snps);
+    }
+};
+
+/*
+    레코드 검색을 시작하는 함수
+    결과 캐시가 있으면 모든 패턴을 먼저 캐시에서 찾고, 미스가 난 패턴만 워커 풀에 제출한다.
+    캐시에서 찾은 패턴의 SNP 위치는 저장된 값으로 표시하며, 결과는 finishRecordScan으로 받는다.
+    검색할 패턴이 모두 32염기 이하이고 d ≤ 1이면 패턴별 커널 대신 k-mer 엔진을 사용
+    @parameters
+    - record: 검색할 레코드 (finishRecordScan이 끝날 때까지 유지해야 함)
+    - root: Aho-Corasick 트라이의 루트 노드
+    - sequences: 검색할 패턴 리스트
+    - d: 허용할 오차 개수
+    - cache: 결과 캐시 (nullptr이면 모든 패턴을 검색, FULL, POSITIONS 모드의 일반 레코드에서만 사용)
+    - mode: 출력 모드 (FULL, POSITIONS가 아니면 결과를 finishRecordScreen으로 받음)
+    - found: 패턴별 발견 여부 (EXISTS 모드에서 사용, 이미 찾은 패턴은 검색하지 않음)
+    @returns
+    - 진행 중인 검색 상태
+*/
+std::shared_ptr<RecordScanJob> beginRecordScan(
+    const SequenceRecord& record, TrieNode* root, const std::vector<std::string>& sequences, int d, ResultCache* cache,
+    const OutputMode& mode = OutputMode(), std::shared_ptr<std::vector<std::atomic<bool>>> found = nullptr) {
+
+    std::shared_ptr<RecordScanJob> job = std::make_shared<RecordScanJob>();
+    job->record = &record;
+    job->root = root;
+    job->d = d;
+    job->mode = mode;
+    job->found = mode.kind == OutputKind::EXISTS ? found : nullptr;
+
+    // 이음 레코드는 경계를 지나는 매칭만 찾으므로 결과 캐시를 사용하지 않음
+    if (record.seamSplit > 0) cache = nullptr;
+
+    if (!mode.keepsPositions()) {
+        // k-mer 엔진은 테이블을 레코드 사이에 재사용하도록 이미 찾은 패턴도 남겨 둠 (작업에서 건너뜀)
+        bool skipFound = job->found && !KmerProbeTable::applicable(sequences, d);
+        for (size_t i = 0; i < sequences.size(); ++i) {
+            if (skipFound && (*job->found)[i].load(std::memory_order_relaxed)) continue;
+            job->slots.push_back(i);
+            job->patterns.push_back(sequences[i]);
+        }
+    } else if (cache == nullptr) {
+        job->results.resize(sequences.size());
+        job->patterns = sequences;
+        for (size_t i = 0; i < sequences.size(); ++i) {
+            job->slots.push_back(i);
+        }
+    } else {
+        job->results.resize(sequences.size());
+        // 캐시 조회
+        // k-mer 엔진은 테이블을 레코드 사이에 재사용하도록 적중한 패턴도 남겨 둠 (작업에서 건너뜀)
+        ScopedPhase phase("cache_lookup", "phase", record.name);
+        job->chunkDigest = contentDigest(record.text);
+        bool keepHits = KmerProbeTable::applicable(sequences, d);
+        bool anyMiss = false;
+        for (size_t i = 0; i < sequences.size(); ++i) {
+            std::vector<long long> snps;
+            bool hit = cache->lookup(job->chunkDigest, record.text.length(), sequences[i], d, job->results[i], snps);
+            if (hit) {
+                for (long long snpPos : snps) {
+                    if (mode.kind == OutputKind::FULL) globalSnpPositions.set(record.offset + snpPos);
+                }
+            } else {
+                anyMiss = true;
+            }
+            if (!hit || keepHits) {
+                job->slots.push_back(i);
+                job->patterns.push_back(sequences[i]);
+                job->cached.push_back(hit);
+            }
+        }
+        if (!anyMiss) {
+            // 모든 패턴이 적중하면 검색하지 않음
+            job->slots.clear();
+            job->patterns.clear();
+            job->cached.clear();
+        }
+    }
+
+    if (!job->patterns.empty()) {
+        job->kmerTable = kmerTableFor(job->patterns, d);
+        scanPool().submit(job);
+    }
+    return job;
+}
+
+/*
+    레코드 검색이 끝날 때까지 기다린 뒤 결과를 반환하는 함수
+    미스가 난 패턴의 결과는 캐시에 저장
+    @parameters
+    - job: beginRecordScan이 반환한 검색 상태
+    - cache: beginRecordScan에 전달한 결과 캐시
+    @returns
+    - 패턴별 매칭 위치 (레코드 기준 위치)
+*/
+std::vector<std::vector<long long>> finishRecordScan(RecordScanJob& job, ResultCache* cache) {
+    scanPool().wait(job);
+
+    const SequenceRecord& record = *job.record;
+    for (size_t j = 0; j < job.patterns.size(); ++j) {
+        if (job.fromCache(j)) continue; // 결과는 beginRecordScan에서 이미 채움
+        std::vector<long long>& matches = job.collected[j].positions;
+        if (cache && record.seamSplit == 0) {
+            std::vector<long long> snps = collectSnpPositions(record.text, job.patterns[j], matches);
+            cache->store(job.chunkDigest, record.text.length(), job.patterns[j], job.d, matches, snps);
+        }
+        job.results[job.slots[j]] = std::move(matches);
+    }
+    return std::move(job.results);
+}
+
+/*
+    FULL이 아닌 모드로 시작한 레코드 검색이 끝날 때까지 기다린 뒤 수집기를 반환하는 함수
+    @parameters
+    - job: beginRecordScan이 반환한 검색 상태
+    - numSequences: 전체 패턴 수
+    @returns
+    - 전체 패턴별 수집기 (건너뛴 패턴은 빈 수집기, 위치는 레코드 기준 위치)
+*/
+std::vector<MatchCollector> finishRecordScreen(RecordScanJob& job, size_t numSequences) {
+    scanPool().wait(job);
+
+    std::vector<MatchCollector> results(numSequences, MatchCollector(job.mode));
+    for (size_t j = 0; j < job.patterns.size(); ++j) {
+        results[job.slots[j]] = std::move(job.collected[j]);
+    }
+    return results;
+}
+
+/*
+    레코드 하나를 검색하고 결과를 기다리는 함수 (beginRecordScan + finishRecordScan)
+    @returns
+    - 패턴별 매칭 위치 (레코드 기준 위치)
+*/
+std::vector<std::vector<long long>> scanRecordCached(
+    const SequenceRecord& record, TrieNode* root, const std::vector<std::string>& sequences, int d, ResultCache* cache) {
+    std::shared_ptr<RecordScanJob> job = beginRecordScan(record, root, sequences, d, cache);
+    return finishRecordScan(*job, cache);
+}
+
+/*
+    매칭 결과를 기반으로 텍스트를 변환하는 함수
+    @parameters
+    - originalText: 원본 문자열
+    - matches: 매칭된 위치의 벡터 (패턴별 매칭 위치)
+    - sequences: 비교에 사용된 패턴 문자열 리스트
+    - transitionProb: 전이 확률 행렬
+    @returns
+    - 변환된 문자열
+*/
+std::string transformText(
+    const std::string& originalText,
+    const std::vector<std::vector<long long>>& matches,
+    const std::vector<std::string>& sequences,
+    const std::vector<std::vector<double>>& transitionProb) {
+
+    // 결과 텍스트를 저장할 문자열
+    std::string resultText = originalText;
+
+    // 오차 발생 시 전이 확률 행렬을 기반으로 새로운 문자 생성
+    auto generateRandomBase = [&](char currentBase) -> char {
+        static const char bases[] = {'A', 'T', 'C', 'G'};
+        int currentIndex = charToIndex(currentBase);
+        if (currentIndex == -1) return currentBase; // 유효하지 않은 문자 처리
+
+        // 전이 확률을 기반으로 랜덤 선택
+        double r = (double)rand() / RAND_MAX;
+        double cumulative = 0.0;
+        for (int i = 0; i < 4; ++i) {
+            cumulative += transitionProb[currentIndex][i];
+            if (r <= cumulative) {
+                return bases[i];
+            }
+        }
+        return currentBase; // 기본적으로 현재 문자 반환
+    };
+
+    // 매칭된 부분을 비교에 사용한 패턴 문자열로 교체
+    for (int i = 0; i < matches.size(); ++i) {
+        for (long long matchIndex : matches[i]) {
+            for (size_t k = 0; k < sequences[i].length(); ++k) {
+                if (matchIndex + k < resultText.length()) {
+                    if (resultText[matchIndex + k] != sequences[i][k]) {
+                        // 오차 발생: 전이 확률 기반으로 수정
+                        resultText[matchIndex + k] = generateRandomBase(resultText[matchIndex + k]);
+                    } else {
+                        // 매칭: 비교에 사용한 패턴 문자열로 대체
+                        resultText[matchIndex + k] = sequences[i][k];
+                    }
+                }
+            }
+        }
+    }
+
+    return resultText;
+}
+
+/*
+    결과 기록 단계에서 집계한 값
+*/
+struct WriterSummary {
+    long long totalErrors = 0; // 원본과 변환된 문자열 사이의 오차 개수
+    long long totalLength = 0; // 기록한 전체 문자열 길이
+};
+
+/*
+    결과 기록 단계: 레코드별로 변환된 텍스트를 파일에 이어 쓰고 원본과의 오차를 집계
+    스캐너가 다음 레코드를 검색하는 동안 이전 레코드의 결과를 기록한다.
+    변환된 파일을 다시 읽지 않고 메모리에서 바로 오차를 계산
+    @parameters
+    - in: 스캐너에서 오는 큐
+    - sequences: 비교에 사용된 패턴 문자열 리스트
+    - transitionProb: 전이 확률 행렬
+    - outputFileName: 저장할 파일 이름
+    - matchesFileName: 매칭 위치를 염색체 좌표와 함께 저장할 TSV 파일 이름 (비어 있으면 저장하지 않음)
+    - summary: 집계 결과를 저장할 구조체
+*/
+void writerStage(BoundedQueue<RecordResult>& in,
+                 const std::vector<std::string>& sequences,
+                 const std::vector<std::vector<double>>& transitionProb,
+                 const std::string& outputFileName,
+                 const std::string& matchesFileName,
+                 WriterSummary& summary) {
+    std::ofstream outputFile(outputFileName);
+    if (!outputFile) {
+        std::cerr << "파일을 생성할 수 없습니다: " << outputFileName << std::endl;
+        exit(1);
+    }
+
+    std::ofstream matchesFile;
+    if (!matchesFileName.empty()) {
+        matchesFile.open(matchesFileName);
+        if (!matchesFile) {
+            std::cerr << "파일을 생성할 수 없습니다: " << matchesFileName << std::endl;
+            exit(1);
+        }
+        matchesFile << "pattern_index\tpattern\tchromosome\tposition\tglobal_index\n";
+    }
+
+    RecordResult result;
+    while (in.pop(result)) {
+        // 매칭 위치를 (염색체, 염색체 안의 위치, 전역 위치)로 기록
+        if (matchesFile.is_open()) {
+            const SequenceRecord& record = result.record;
+            for (size_t i = 0; i < result.matches.size(); ++i) {
+                for (long long matchIndex : result.matches[i]) {
+                    matchesFile << (i + 1) << '\t' << sequences[i] << '\t' << record.name << '\t'
+                                << record.position + matchIndex << '\t' << record.offset + matchIndex << '\n';
+                }
+            }
+        }
+
+        // 이음 레코드의 염기는 앞뒤 레코드에서 이미 기록됨
+        if (result.record.seamSplit > 0) continue;
+
+        const std::string& originalText = result.record.text;
+        std::string resultText;
+        {
+            ScopedPhase phase("transform_write", "phase", result.record.name);
+            resultText = transformText(originalText, result.matches, sequences, transitionProb);
+            outputFile << resultText;
+        }
+
+        // 오차 계산
+        ScopedPhase phase("error_rate", "phase", result.record.name);
+        for (size_t i = 0; i < originalText.length(); ++i) {
+            if (originalText[i] != resultText[i]) {
+                summary.totalErrors++;
+            }
+        }
+        summary.totalLength += originalText.length();
+    }
+
+    outputFile.close();
+}
+
+
+/*
+    SNP 색인에 함께 저장하는 레코드의 위치 정보
+    전역 위치 [offset, offset + length)가 염색체 name의 [position, position + length)에 해당
+*/
+struct RecordExtent {
+    std::string name;
+    long long offset = 0;
+    long long position = 0;
+    long long length = 0;
+};
+
+/*
+    SNP 비트맵의 rank/select 색인
+    512비트 블록마다 슈퍼블록 시작부터의 개수(16비트), 65536비트 슈퍼블록마다 누적 개수(64비트)를 저장하므로
+    추가 공간은 비트맵의 약 3%이고, 구간 개수는 최대 8워드의 popcount로 상수 시간에 계산된다.
+    검색이 끝난 뒤 슈퍼블록 단위로 나누어 여러 스레드에서 구축
+*/
+class SnpRankIndex {
+public:
+    static const int WORDS_PER_BLOCK = 8;               // 512비트
+    static const int BLOCKS_PER_SUPERBLOCK = 128;       // 65536비트
+
+    /*
+        비트맵으로부터 색인을 구축하는 함수 (비트맵은 색인을 사용하는 동안 유지해야 함)
+        @parameters
+        - bitmap: SNP 비트맵
+    */
+    void build(const SnpBitmap& bitmap) {
+        bits = &bitmap;
+        length = bitmap.size();
+        long long numWords = bitmap.numWords();
+        long long numBlocks = (numWords + WORDS_PER_BLOCK - 1) / WORDS_PER_BLOCK;
+        long long numSuperblocks = (numBlocks + BLOCKS_PER_SUPERBLOCK - 1) / BLOCKS_PER_SUPERBLOCK;
+        blocks.assign(numBlocks, 0);
+        superblocks.assign(numSuperblocks + 1, 0);
+
+        // 슈퍼블록 구간을 스레드별로 나누어 블록 개수와 슈퍼블록 합계를 계산
+        unsigned numThreads = std::max<long long>(1, std::min<long long>(NUM_THREADS, numSuperblocks));
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < numThreads; ++t) {
+            threads.emplace_back([&, t]() {
+                long long first = numSuperblocks * t / numThreads;
+                long long last = numSuperblocks * (t + 1) / numThreads;
+                for (long long s = first; s < last; ++s) {
+                    uint64_t inSuperblock = 0;
+                    long long blockEnd = std::min(numBlocks, (s + 1) * BLOCKS_PER_SUPERBLOCK);
+                    for (long long b = s * BLOCKS_PER_SUPERBLOCK; b < blockEnd; ++b) {
+                        blocks[b] = inSuperblock;
+                        long long wordEnd = std::min(numWords, (b + 1) * WORDS_PER_BLOCK);
+                        for (long long w = b * WORDS_PER_BLOCK; w < wordEnd; ++w) {
+                            inSuperblock += __builtin_popcountll(wordAt(w));
+                        }
+                    }
+                    superblocks[s + 1] = inSuperblock;
+                }
+            });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+
+        // 슈퍼블록 합계를 누적 개수로 변환
+        for (long long s = 0; s < numSuperblocks; ++s) {
+            superblocks[s + 1] += superblocks[s];
+        }
+    }
+
+    long long size() const { return length; }
+
+    // 전체 SNP 개수
+    long long total() const { return superblocks.empty() ? 0 : superblocks.back(); }
+
+    // [0, pos) 구간의 SNP 개수
+    long long rank(long long pos) const {
+        if (pos <= 0) return 0;
+        if (pos >= length) return total();
+        long long w = pos >> 6;
+        long long b = w / WORDS_PER_BLOCK;
+        long long result = superblocks[b / BLOCKS_PER_SUPERBLOCK] + blocks[b];
+        for (long long x = b * WORDS_PER_BLOCK; x < w; ++x) {
+            result += __builtin_popcountll(wordAt(x));
+        }
+        if (pos & 63) {
+            result += __builtin_popcountll(wordAt(w) & ((1ULL << (pos & 63)) - 1));
+        }
+        return result;
+    }
+
+    // [a, b) 구간의 SNP 개수
+    long long count(long long a, long long b) const {
+        return a < b ? rank(b) - rank(a) : 0;
+    }
+
+    /*
+        k번째(0부터) SNP의 위치를 찾는 함수
+        @returns
+        - 전역 위치 (k가 전체 개수 이상이면 -1)
+    */
+    long long select(long long k) const {
+        if (k < 0 || k >= total()) return -1;
+
+        // 누적 개수가 k 이하인 마지막 슈퍼블록
+        long long s = std::upper_bound(superblocks.begin(), superblocks.end(), static_cast<uint64_t>(k))
+                      - superblocks.begin() - 1;
+        long long remaining = k - superblocks[s];
+
+        // 슈퍼블록 안에서 개수가 remaining 이하인 마지막 블록
+        auto blockBegin = blocks.begin() + s * BLOCKS_PER_SUPERBLOCK;
+        auto blockEnd = blocks.begin() + std::min<long long>(blocks.size(), (s + 1) * BLOCKS_PER_SUPERBLOCK);
+        long long b = std::upper_bound(blockBegin, blockEnd, static_cast<uint16_t>(remaining)) - blocks.begin() - 1;
+        remaining -= blocks[b];
+
+        // 블록 안의 워드와 비트
+        for (long long w = b * WORDS_PER_BLOCK;; ++w) {
+            uint64_t value = wordAt(w);
+            long long inWord = __builtin_popcountll(value);
+            if (remaining < inWord) {
+                for (; remaining > 0; --remaining) {
+                    value &= value - 1; // 가장 낮은 비트 제거
+                }
+                return w * 64 + __builtin_ctzll(value);
+            }
+            remaining -= inWord;
+        }
+    }
+
+    /*
+        [a, b) 구간을 window 크기의 구간으로 나누어 구간별 SNP 개수를 계산하는 함수
+        @returns
+        - 구간별 SNP 개수 (마지막 구간은 b에서 잘림)
+    */
+    std::vector<long long> histogram(long long a, long long b, long long window) const {
+        std::vector<long long> counts;
+        if (window <= 0) return counts;
+        long long previous = rank(a);
+        for (long long start = a; start < b; start += window) {
+            long long current = rank(std::min(b, start + window));
+            counts.push_back(current - previous);
+            previous = current;
+        }
+        return counts;
+    }
+
+    /*
+        비트맵, 색인, 레코드 위치 정보를 파일로 저장하는 함수
+        @parameters
+        - fileName: 저장할 파일 이름
+        - records: 레코드 위치 정보
+        @returns
+        - 저장 성공 여부
+    */
+    bool save(const std::string& fileName, const std::vector<RecordExtent>& records) const {
+        std::ofstream out(fileName, std::ios::binary);
+        if (!out) return false;
+
+        auto writeValue = [&](uint64_t value) { out.write(reinterpret_cast<const char*>(&value), sizeof(value)); };
+        out.write(INDEX_MAGIC, 8);
+        writeValue(length);
+        writeValue(records.size());
+        for (const RecordExtent& r : records) {
+            writeValue(r.name.size());
+            out.write(r.name.data(), r.name.size());
+            writeValue(r.offset);
+            writeValue(r.position);
+            writeValue(r.length);
+        }
+        for (long long w = 0; w < bits->numWords(); ++w) {
+            writeValue(wordAt(w));
+        }
+        out.write(reinterpret_cast<const char*>(superblocks.data()), superblocks.size() * sizeof(uint64_t));
+        out.write(reinterpret_cast<const char*>(blocks.data()), blocks.size() * sizeof(uint16_t));
+        return static_cast<bool>(out);
+    }
+
+    /*
+        save로 저장한 파일을 읽는 함수
+        @parameters
+        - fileName: 색인 파일 이름
+        - records: 저장된 레코드 위치 정보를 받을 벡터
+        @returns
+        - 읽기 성공 여부
+    */
+    bool load(const std::string& fileName, std::vector<RecordExtent>& records) {
+        std::ifstream in(fileName, std::ios::binary);
+        char magic[8];
+        if (!in.read(magic, 8) || std::memcmp(magic, INDEX_MAGIC, 8) != 0) return false;
+
+        // 손상되었거나 다른 형식의 파일에서 읽은 크기로 메모리를 할당하지 않도록 남은 파일 크기와 비교
+        std::error_code ec;
+        uint64_t fileSize = std::filesystem::file_size(fileName, ec);
+        if (ec) return false;
+        auto remaining = [&]() { return fileSize - static_cast<uint64_t>(in.tellg()); };
+
+        uint64_t value = 0;
+        auto readValue = [&]() {
+            return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+        };
+        if (!readValue() || value > static_cast<uint64_t>(SnpBitmap::MAX_LENGTH)) return false;
+        length = value;
+        // 레코드마다 최소 32바이트 (이름 길이, 위치 3개)
+        if (!readValue() || value > remaining() / 32) return false;
+        records.resize(value);
+        for (RecordExtent& r : records) {
+            if (!readValue() || value > remaining()) return false;
+            r.name.resize(value);
+            if (!in.read(&r.name[0], r.name.size())) return false;
+            if (!readValue()) return false;
+            r.offset = value;
+            if (!readValue()) return false;
+            r.position = value;
+            if (!readValue()) return false;
+            r.length = value;
+        }
+
+        // 남은 크기가 length로 정해지는 비트맵과 색인의 크기와 정확히 같아야 함
+        uint64_t numWords = (length + 63) / 64;
+        uint64_t numBlocks = (numWords + WORDS_PER_BLOCK - 1) / WORDS_PER_BLOCK;
+        uint64_t numSuperblocks = (numBlocks + BLOCKS_PER_SUPERBLOCK - 1) / BLOCKS_PER_SUPERBLOCK + 1;
+        if (remaining() != numWords * sizeof(uint64_t) + numSuperblocks * sizeof(uint64_t) + numBlocks * sizeof(uint16_t)) {
+            return false;
+        }
+
+        ownedBits.reset(new SnpBitmap());
+        ownedBits->extend(length);
+        for (long long w = 0; w < ownedBits->numWords(); ++w) {
+            if (!readValue()) return false;
+            ownedBits->word(w).store(value, std::memory_order_relaxed);
+        }
+        bits = ownedBits.get();
+
+        blocks.resize(numBlocks);
+        superblocks.resize(numSuperblocks);
+        in.read(reinterpret_cast<char*>(superblocks.data()), superblocks.size() * sizeof(uint64_t));
+        in.read(reinterpret_cast<char*>(blocks.data()), blocks.size() * sizeof(uint16_t));
+        return static_cast<bool>(in);
+    }
+
+private:
+    static constexpr const char* INDEX_MAGIC = "AHOSNPX1";
+
+    const SnpBitmap* bits = nullptr;
+    std::unique_ptr<SnpBitmap> ownedBits;   // load로 읽은 비트맵
+    long long length = 0;
+    std::vector<uint64_t> superblocks;      // 슈퍼블록 시작 전까지의 누적 개수 (마지막 원소는 전체 개수)
+    std::vector<uint16_t> blocks;           // 슈퍼블록 시작부터 블록 시작 전까지의 개수
+
+    uint64_t wordAt(long long w) const {
+        return bits->word(w).load(std::memory_order_relaxed);
+    }
+};
+
+/*
+    레코드 좌표 구간 [start, end)에 해당하는 전역 구간들을 순회하는 함수
+    한 염색체가 여러 레코드(파일)로 나뉘어 있으면 겹치는 모든 레코드에 대해 visit을 호출
+    @parameters
+    - records: 레코드 위치 정보
+    - name: 염색체(레코드) 이름
+    - start, end: 염색체 내 구간
+    - visit: (전역 시작, 전역 끝)을 받는 함수
+*/
+template <typename Visit>
+void forEachGlobalRange(const std::vector<RecordExtent>& records, const std::string& name,
+                        long long start, long long end, Visit visit) {
+    for (const RecordExtent& r : records) {
+        if (r.name != name) continue;
+        long long from = std::max(start, r.position);
+        long long to = std::min(end, r.position + r.length);
+        if (from < to) {
+            visit(r.offset + (from - r.position), r.offset + (to - r.position));
+        }
+    }
+}
+
+/*
+    레코드별 SNP 밀도 트랙을 출력하는 함수
+    각 줄은 "레코드 이름\t시작\t끝\tSNP 개수" (염색체 좌표)
+    @parameters
+    - out: 출력 스트림
+    - index: SNP rank/select 색인
+    - records: 레코드 위치 정보
+    - window: 구간 크기
+    - name: 출력할 레코드 이름 (비어 있으면 모든 레코드)
+*/
+void writeSnpDensity(std::ostream& out, const SnpRankIndex& index, const std::vector<RecordExtent>& records,
+                     long long window, const std::string& name = "") {
+    std::string buffer;
+    for (const RecordExtent& r : records) {
+        if (!name.empty() && r.name != name) continue;
+        std::vector<long long> counts = index.histogram(r.offset, r.offset + r.length, window);
+        for (size_t i = 0; i < counts.size(); ++i) {
+            long long start = r.position + i * window;
+            long long end = std::min(start + window, r.position + r.length);
+            buffer += r.name + "\t" + std::to_string(start) + "\t" + std::to_string(end) + "\t" +
+                      std::to_string(counts[i]) + "\n";
+        }
+        out << buffer;
+        buffer.clear();
+    }
+}
+
+/*
+    SNP 색인 질의 모드 (--snp-query)
+    저장된 색인을 읽어 표준 입력의 질의에 답한다.
+    - count A B / count 이름 A B: 전역 구간 또는 염색체 구간 [A, B)의 SNP 개수
+    - select K: K번째(0부터) SNP의 전역 위치와 염색체 위치
+    - hist W [이름]: W 크기 구간별 SNP 개수 (이름을 생략하면 모든 레코드)
+    @parameters
+    - fileName: 색인 파일 이름
+*/
+void runSnpQueries(const std::string& fileName) {
+    SnpRankIndex index;
+    std::vector<RecordExtent> records;
+    if (!index.load(fileName, records)) {
+        std::cerr << "SNP 색인을 읽을 수 없습니다: " << fileName << std::endl;
+        exit(1);
+    }
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::istringstream fields(line);
+        std::string command;
+        if (!(fields >> command)) continue;
+
+        if (command == "count") {
+            std::vector<std::string> args;
+            std::string arg;
+            while (fields >> arg) args.push_back(arg);
+            if (args.size() == 2) {
+                std::cout << index.count(std::stoll(args[0]), std::stoll(args[1])) << "\n";
+            } else if (args.size() == 3) {
+                long long total = 0;
+                forEachGlobalRange(records, args[0], std::stoll(args[1]), std::stoll(args[2]),
+                                   [&](long long a, long long b) { total += index.count(a, b); });
+                std::cout << total << "\n";
+            } else {
+                std::cout << "사용법: count [이름] A B\n";
+            }
+        } else if (command == "select") {
+            long long k = -1;
+            fields >> k;
+            long long pos = index.select(k);
+            if (pos < 0) {
+                std::cout << "없음\n";
+                continue;
+            }
+            std::cout << pos;
+            for (const RecordExtent& r : records) {
+                if (pos >= r.offset && pos < r.offset + r.length) {
+                    std::cout << "\t" << r.name << "\t" << (r.position + pos - r.offset);
+                    break;
+                }
+            }
+            std::cout << "\n";
+        } else if (command == "hist") {
+            long long window = 0;
+            std::string name;
+            fields >> window >> name;
+            if (window <= 0) {
+                std::cout << "사용법: hist W [이름]\n";
+                continue;
+            }
+            writeSnpDensity(std::cout, index, records, window, name);
+        } else {
+            std::cout << "알 수 없는 명령입니다: " << command << "\n";
+        }
+        std::cout.flush();
+    }
+}
+
+/*
+    패턴 패널 파일을 읽는 함수
+    한 줄에 하나의 패턴을 적으며, 빈 줄과 '#'으로 시작하는 줄은 무시. 중복된 패턴은 한 번만 사용
+    @parameters
+    - fileName: 패널 파일 이름
+    @returns
+    - 패턴 리스트
+*/
+std::vector<std::string> loadPatternPanel(const std::string& fileName) {
+    std::ifstream inputFile(fileName);
+    if (!inputFile) {
+        std::cerr << "파일을 열 수 없습니다: " << fileName << std::endl;
+        exit(1);
+    }
+
+    std::vector<std::string> panel;
+    std::unordered_map<std::string, int> seen;
+    std::string line;
+    while (std::getline(inputFile, line)) {
+        line.erase(std::remove_if(line.begin(), line.end(),
+                                  [](unsigned char c) { return std::isspace(c); }), line.end());
+        if (line.empty() || line[0] == '#') continue;
+        if (seen.emplace(line, panel.size()).second) {
+            panel.push_back(line);
+        }
+    }
+
+    if (panel.empty()) {
+        std::cerr << "패널에 패턴이 없습니다: " << fileName << std::endl;
+        exit(1);
+    }
+    return panel;
+}
+
+/*
+    입력 목록(manifest) 파일을 읽는 함수
+    한 줄에 "파일경로 [염색체 [시작위치]]" 형식으로 적으며, '#' 이후는 주석으로 무시.
+    같은 염색체를 여러 파일로 나눈 경우 시작위치를 지정하면 매칭 위치가 염색체 좌표로 보고됨
+    @parameters
+    - fileName: manifest 파일 이름
+    @returns
+    - 입력 파일 리스트
+*/
+std::vector<InputFile> loadManifest(const std::string& fileName) {
+    std::ifstream inputFile(fileName);
+    if (!inputFile) {
+        std::cerr << "파일을 열 수 없습니다: " << fileName << std::endl;
+        exit(1);
+    }
+
+    std::vector<InputFile> inputs;
+    std::string line;
+    while (std::getline(inputFile, line)) {
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+
+        std::istringstream fields(line);
+        InputFile input;
+        if (!(fields >> input.path)) continue;
+        fields >> input.label;
+        if (!(fields >> input.start)) input.start = 0;
+        inputs.push_back(input);
+    }
+
+    if (inputs.empty()) {
+        std::cerr << "manifest에 입력 파일이 없습니다: " << fileName << std::endl;
+        exit(1);
+    }
+    return inputs;
+}
+
+/*
+    저장된 매칭들의 불일치 위치(SNP)를 차례로 전달하는 함수
+    텍스트를 다시 검색하지 않고 매칭 위치의 문자만 다시 비교
+    @parameters
+    - records: 메모리에 유지된 레코드 (offset 순서)
+    - pattern: 패턴 문자열
+    - matches: 패턴의 매칭 위치 (전체 서열 기준 위치)
+    - visit: 불일치 위치(전체 서열 기준 위치)마다 호출되는 함수
+*/
+template <typename Visit>
+void forEachMatchSnp(const std::vector<SequenceRecord>& records, const std::string& pattern,
+                     const std::vector<long long>& matches, Visit&& visit) {
+    for (long long matchIndex : matches) {
+        // 매칭 위치가 속한 레코드 찾기 (이어진 레코드의 경계에 걸친 매칭은 다음 레코드로 넘어감)
+        auto it = std::upper_bound(records.begin(), records.end(), matchIndex,
+                                   [](long long pos, const SequenceRecord& r) { return pos < r.offset; });
+        size_t r = it - records.begin() - 1;
+        for (size_t k = 0; k < pattern.length(); ++k) {
+            long long pos = matchIndex + k;
+            while (r + 1 < records.size() && pos >= records[r + 1].offset) ++r;
+            if (records[r].text[pos - records[r].offset] != pattern[k]) {
+                visit(pos);
+            }
+        }
+    }
+}
+
+/*
+    패널 갱신 모드
+    표준 입력에서 "+패턴"(추가), "-패턴"(삭제) 명령을 받아 트라이를 증분 갱신하고,
+    "scan" 명령 또는 입력 끝에서 새로 추가된 패턴만으로 레코드를 검색한다.
+    변경되지 않은 패턴은 저장된 매칭 결과를 그대로 사용하므로 갱신 비용은 변경된 패턴 수에 비례
+    @parameters
+    - root: Aho-Corasick 트라이의 루트 노드
+    - sequences: 패턴 리스트 (삭제된 패턴은 빈 문자열로 남겨 인덱스를 유지)
+    - allPatternMatches: 패턴별 매칭 위치 (전체 서열 기준 위치)
+    - records: 메모리에 유지된 레코드
+    - d: 허용할 오차 개수
+    - cache: 결과 캐시 (사용하지 않으면 nullptr)
+*/
+void runPanelUpdates(TrieNode* root,
+                     std::vector<std::string>& sequences,
+                     std::vector<std::vector<long long>>& allPatternMatches,
+                     const std::vector<SequenceRecord>& records,
+                     int d,
+                     ResultCache* cache) {
+    std::unordered_map<std::string, int> indexOf;
+    for (size_t i = 0; i < sequences.size(); ++i) {
+        if (!sequences[i].empty()) indexOf[sequences[i]] = i;
+    }
+
+    std::vector<int> added;   // 아직 검색하지 않은 추가 패턴
+    std::vector<std::pair<std::string, std::vector<long long>>> removed; // 마지막 검색 이후 삭제된 패턴과 매칭 위치
+
+    // SNP 위치별로 그 위치를 불일치로 포함하는 매칭 수 (처음 패턴을 삭제할 때 구축)
+    // 삭제된 패턴의 매칭만 빼고 0이 된 위치만 지우므로 갱신 비용은 변경된 매칭 수에 비례
+    std::unordered_map<long long, int> snpRefs;
+    bool snpRefsReady = false;
+    auto addRefs = [&](const std::string& pattern, const std::vector<long long>& matches) {
+        forEachMatchSnp(records, pattern, matches, [&](long long pos) { snpRefs[pos]++; });
     };
 
-    // 매칭된 부분을 비교에 사용한 패턴 문자열로 교체
-    for (int i = 0; i < matches.size(); ++i) {
-        for (long long matchIndex : matches[i]) {
-            for (size_t k = 0; k < sequences[i].length(); ++k) {
-                if (matchIndex + k < resultText.length()) {
-                    if (resultText[matchIndex + k] != sequences[i][k]) {
-                        // 오차 발생: 전이 확률 기반으로 수정
-                        resultText[matchIndex + k] = generateRandomBase(resultText[matchIndex + k]);
-                    } else {
-                        // 매칭: 비교에 사용한 패턴 문자열로 대체
-                        resultText[matchIndex + k] = sequences[i][k];
+    std::cout << "\n패널 갱신 명령을 입력하세요 (+패턴: 추가, -패턴: 삭제, scan: 적용, quit: 종료)\n";
+    std::string command;
+    bool running = true;
+    while (running) {
+        if (!(std::cin >> command) || command == "quit") {
+            running = false;
+            command = "scan"; // 입력이 끝나면 남은 변경 사항 적용
+        }
+
+        if (command[0] == '+' && command.length() > 1) {
+            std::string pattern = command.substr(1);
+            if (indexOf.count(pattern)) {
+                std::cout << "이미 패널에 있는 패턴입니다: " << pattern << "\n";
+                continue;
+            }
+            int index = sequences.size();
+            sequences.push_back(pattern);
+            allPatternMatches.emplace_back();
+            indexOf[pattern] = index;
+            addPatternIncremental(root, pattern, index);
+            added.push_back(index);
+        } else if (command[0] == '-' && command.length() > 1) {
+            std::string pattern = command.substr(1);
+            auto it = indexOf.find(pattern);
+            if (it == indexOf.end()) {
+                std::cout << "패널에 없는 패턴입니다: " << pattern << "\n";
+                continue;
+            }
+            int index = it->second;
+            removePatternIncremental(root, pattern, index);
+            indexOf.erase(it);
+            removed.emplace_back(std::move(sequences[index]), std::move(allPatternMatches[index]));
+            sequences[index].clear();
+            std::vector<long long>().swap(allPatternMatches[index]);
+            added.erase(std::remove(added.begin(), added.end(), index), added.end());
+        } else if (command == "scan") {
+            if (added.empty() && removed.empty()) continue;
+            ScopedPhase phase("panel_update");
+
+            // 새로 추가된 패턴만 검색 (SNP 위치는 검색 중에 표시됨)
+            std::vector<std::string> addedPatterns;
+            for (int index : added) {
+                addedPatterns.push_back(sequences[index]);
+            }
+            if (!addedPatterns.empty()) {
+                // 이어진 레코드 사이의 경계도 추가된 패턴의 가장 긴 길이에 맞춰 검색
+                int maxPatternLength = 0;
+                for (const std::string& pattern : addedPatterns) {
+                    maxPatternLength = std::max<int>(maxPatternLength, pattern.length());
+                }
+                auto scan = [&](const SequenceRecord& r) {
+                    std::vector<std::vector<long long>> matches = scanRecordCached(r, root, addedPatterns, d, cache);
+                    for (size_t j = 0; j < added.size(); ++j) {
+                        for (long long matchIndex : matches[j]) {
+                            allPatternMatches[added[j]].push_back(r.offset + matchIndex);
+                        }
+                    }
+                };
+                for (const SequenceRecord& r : records) {
+                    scan(r);
+                }
+                for (const SequenceRecord& r : buildSeamRecords(records, maxPatternLength)) {
+                    scan(r);
+                }
+                if (snpRefsReady) {
+                    for (int index : added) {
+                        addRefs(sequences[index], allPatternMatches[index]);
+                    }
+                }
+            }
+
+            // 삭제된 패턴만 표시한 SNP 위치를 지움
+            if (!removed.empty()) {
+                if (!snpRefsReady) {
+                    for (size_t i = 0; i < sequences.size(); ++i) {
+                        if (!sequences[i].empty()) addRefs(sequences[i], allPatternMatches[i]);
+                    }
+                    for (const auto& entry : removed) {
+                        addRefs(entry.first, entry.second);
+                    }
+                    snpRefsReady = true;
+                }
+                for (const auto& entry : removed) {
+                    forEachMatchSnp(records, entry.first, entry.second, [&](long long pos) {
+                        auto ref = snpRefs.find(pos);
+                        if (--ref->second == 0) {
+                            snpRefs.erase(ref);
+                            globalSnpPositions.reset(pos);
+                        }
+                    });
+                }
+            }
+
+            // 갱신 결과 출력
+            for (int index : added) {
+                std::cout << "\n패턴 " << (index + 1) << ": " << sequences[index] << "\n매칭 인덱스: ";
+                if (allPatternMatches[index].empty()) {
+                    std::cout << "없음";
+                } else {
+                    for (size_t j = 0; j < allPatternMatches[index].size(); ++j) {
+                        std::cout << allPatternMatches[index][j] << (j < allPatternMatches[index].size() - 1 ? ", " : "");
                     }
                 }
+                std::cout << "\n";
             }
+            long long totalSnps = globalSnpPositions.count();
+            std::cout << "\n추가된 패턴: " << added.size() << ", 삭제된 패턴: " << removed.size()
+                      << ", 현재 패널 크기: " << indexOf.size() << std::endl;
+            std::cout << "전체 SNP 개수: " << totalSnps << std::endl;
+            std::cout << "전체 문자열에 대한 오차율: "
+                      << (static_cast<double>(totalSnps) / globalSnpPositions.size()) * 100.0 << "%\n";
+
+            added.clear();
+            removed.clear();
+        } else {
+            std::cout << "알 수 없는 명령입니다: " << command << "\n";
         }
     }
+}
 
-    // 결과 문자열을 파일에 저장
-    outputFile << resultText;
-    outputFile.close();
-    std::cout << "결과 텍스트를 '" << outputFileName << "'에 저장했습니다." << std::endl;
+// 쿼리 서버의 마이크로 배치 설정
+const int BATCH_WINDOW_MS = 5;          // 첫 쿼리가 도착한 뒤 같은 배치로 모을 시간
+const size_t MAX_BATCH_PATTERNS = 4096; // 한 배치에 넣을 최대 패턴 수
+const int CACHE_EVICT_INTERVAL_S = 60;  // 결과 캐시 크기를 확인하는 최소 간격 (초)
 
-    // 또는, resultText의 길이를 출력
-    std::cout << "결과 텍스트의 길이: " << resultText.length() << " 문자\n";
-}
+/*
+    쿼리 서버에 도착한 패턴 쿼리 하나
+    배처가 레코드 하나의 검색을 끝낼 때마다 결과 줄을 lines에 추가하고,
+    연결 스레드가 이를 꺼내 클라이언트로 바로 보낸다.
+*/
+struct PatternQuery {
+    int d = 0;
+    std::vector<std::string> patterns;
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::string> lines;      // 클라이언트로 보낼 결과 줄
+    long long matchCount = 0;
+    bool done = false;
+};
 
 /*
-    원본 문자열과 변환된 문자열을 비교하여 최종 오차율을 계산하는 함수
-    @parameters
-    - originalText: 원본 문자열
-    - transformedFileName: 변환된 문자열이 저장된 파일 이름
-    @returns
-    - 최종 오차율 (백분율)
+    쿼리 마이크로 배처
+    동시에 도착한 쿼리 중 허용 오차가 같은 것들을 하나의 배치로 묶어, 중복을 제거한 패턴으로
+    트라이를 한 번 구축하고 메모리에 유지된 모든 레코드를 공유 워커 풀에서 한 번에 검색한다.
+    레코드 하나의 검색이 끝날 때마다 각 쿼리에 해당 결과를 나누어 전달
 */
-double calculateFinalErrorRate(const std::string& originalText, const std::string& transformedFileName) {
-    // 변환된 파일 읽기
-    std::ifstream inputFile(transformedFileName);
-    if (!inputFile) {
-        std::cerr << "파일을 열 수 없습니다: " << transformedFileName << std::endl;
-        exit(1);
+class QueryBatcher {
+public:
+    QueryBatcher(const std::vector<SequenceRecord>& records, ResultCache* cache)
+        : records(records), cache(cache), batchThread(&QueryBatcher::batchLoop, this) {}
+
+    ~QueryBatcher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        arrived.notify_all();
+        batchThread.join();
     }
 
-    std::string transformedText((std::istreambuf_iterator<char>(inputFile)),
-                                std::istreambuf_iterator<char>());
+    void submit(const std::shared_ptr<PatternQuery>& query) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(query);
+        }
+        arrived.notify_all();
+    }
 
-    // 두 문자열의 길이가 동일한지 확인
-    if (originalText.length() != transformedText.length()) {
-        std::cerr << "오류: 원본 문자열과 변환된 문자열의 길이가 다릅니다." << std::endl;
-        exit(1);
+private:
+    const std::vector<SequenceRecord>& records;
+    ResultCache* cache;
+
+    std::mutex mutex;
+    std::condition_variable arrived;
+    std::deque<std::shared_ptr<PatternQuery>> pending;  // 아직 배치에 들어가지 않은 쿼리 (mutex로 보호)
+    bool stopping = false;
+    std::chrono::steady_clock::time_point lastEviction = std::chrono::steady_clock::now(); // 배치 스레드에서만 사용
+    std::thread batchThread;
+
+    void batchLoop() {
+        while (true) {
+            std::vector<std::shared_ptr<PatternQuery>> batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                arrived.wait(lock, [&]() { return stopping || !pending.empty(); });
+                if (pending.empty()) break;
+
+                // 첫 쿼리 이후 잠시 기다려 동시에 들어오는 쿼리를 모음
+                arrived.wait_for(lock, std::chrono::milliseconds(BATCH_WINDOW_MS), [&]() { return stopping; });
+
+                // 첫 쿼리와 허용 오차가 같은 쿼리를 도착 순서대로 배치에 추가
+                int d = pending.front()->d;
+                size_t batchPatterns = 0;
+                for (auto it = pending.begin(); it != pending.end();) {
+                    if ((*it)->d == d && (batch.empty() || batchPatterns + (*it)->patterns.size() <= MAX_BATCH_PATTERNS)) {
+                        batchPatterns += (*it)->patterns.size();
+                        batch.push_back(*it);
+                        it = pending.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+            runBatch(batch);
+            evictIfDue();
+        }
+    }
+
+    // 서버는 오래 실행되므로 마지막 확인 이후 일정 시간이 지나면 배치 사이에서 캐시 크기를 제한
+    void evictIfDue() {
+        if (!cache) return;
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastEviction < std::chrono::seconds(CACHE_EVICT_INTERVAL_S)) return;
+        ScopedPhase phase("cache_evict");
+        cache->evict();
+        lastEviction = now;
+    }
+
+    void runBatch(const std::vector<std::shared_ptr<PatternQuery>>& batch) {
+        int d = batch.front()->d;
+
+        // 배치 전체에서 중복을 제거한 패턴 리스트
+        std::vector<std::string> sequences;
+        std::unordered_map<std::string, int> indexOf;
+        for (const auto& query : batch) {
+            for (const std::string& pattern : query->patterns) {
+                if (indexOf.emplace(pattern, sequences.size()).second) {
+                    sequences.push_back(pattern);
+                }
+            }
+        }
+        ScopedPhase phase("query_batch", "phase",
+                          std::to_string(batch.size()) + " queries, " + std::to_string(sequences.size()) + " patterns");
+
+        TrieNode* root = new TrieNode();
+        for (size_t i = 0; i < sequences.size(); ++i) {
+            insertPattern(root, sequences[i], i);
+        }
+        buildFailureLinks(root);
+
+        // 이어진 레코드 사이의 경계는 이음 레코드로 검색
+        int maxPatternLength = 0;
+        for (const std::string& pattern : sequences) {
+            maxPatternLength = std::max<int>(maxPatternLength, pattern.length());
+        }
+        std::vector<SequenceRecord> seams = buildSeamRecords(records, maxPatternLength);
+        std::vector<const SequenceRecord*> targets;
+        for (const SequenceRecord& record : records) {
+            targets.push_back(&record);
+        }
+        for (const SequenceRecord& seam : seams) {
+            targets.push_back(&seam);
+        }
+
+        // 모든 레코드를 먼저 제출해 워커 풀이 레코드 사이에서 쉬지 않도록 함
+        std::vector<std::shared_ptr<RecordScanJob>> jobs;
+        // 쿼리 결과에는 SNP가 필요 없으므로 위치만 모음
+        OutputMode mode;
+        mode.kind = OutputKind::POSITIONS;
+        for (const SequenceRecord* record : targets) {
+            jobs.push_back(beginRecordScan(*record, root, sequences, d, cache, mode));
+        }
+
+        for (size_t r = 0; r < targets.size(); ++r) {
+            std::vector<std::vector<long long>> matches = finishRecordScan(*jobs[r], cache);
+            for (std::vector<long long>& positions : matches) {
+                std::sort(positions.begin(), positions.end());
+                positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+            }
+
+            // 쿼리별로 결과 줄을 만들어 전달
+            const SequenceRecord& record = *targets[r];
+            for (const auto& query : batch) {
+                std::vector<std::string> lines;
+                for (const std::string& pattern : query->patterns) {
+                    for (long long matchIndex : matches[indexOf[pattern]]) {
+                        lines.push_back(pattern + "\t" + record.name + "\t" + std::to_string(record.position + matchIndex));
+                    }
+                }
+                std::lock_guard<std::mutex> lock(query->mutex);
+                query->matchCount += lines.size();
+                query->lines.insert(query->lines.end(), lines.begin(), lines.end());
+                query->done = (r + 1 == targets.size());
+                query->ready.notify_all();
+            }
+        }
+        if (targets.empty()) {
+            for (const auto& query : batch) {
+                std::lock_guard<std::mutex> lock(query->mutex);
+                query->done = true;
+                query->ready.notify_all();
+            }
+        }
+
+        // 배치 트라이 삭제
+        std::function<void(TrieNode*)> deleteTrie = [&](TrieNode* node) {
+            if (!node) return;
+            for (auto child : node->children) {
+                deleteTrie(child);
+            }
+            delete node;
+        };
+        deleteTrie(root);
+    }
+};
+
+/*
+    소켓에 버퍼 전체를 쓰는 함수 (클라이언트가 연결을 끊으면 false)
+*/
+bool sendFully(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += n;
     }
+    return true;
+}
+
+/*
+    패턴 쿼리 서버
+    입력 파일을 한 번 읽어 레코드를 메모리에 유지한 채 Unix 소켓에서 패턴 쿼리를 받는다.
+    각 연결은 별도의 스레드에서 처리하며, 검색은 QueryBatcher가 마이크로 배치로 묶어 수행
+*/
+class QueryServer {
+public:
+    QueryServer(const std::vector<SequenceRecord>& records, int defaultD, ResultCache* cache)
+        : batcher(records, cache), defaultD(defaultD) {}
+
+    /*
+        소켓을 열고 "shutdown" 요청을 받을 때까지 연결을 처리하는 함수
+        @parameters
+        - socketPath: Unix 소켓 경로
+    */
+    void run(const std::string& socketPath) {
+        listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (listenFd < 0 || socketPath.size() >= sizeof(address.sun_path)) {
+            std::cerr << "소켓을 생성할 수 없습니다: " << socketPath << std::endl;
+            exit(1);
+        }
+        std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+        // 이전 실행이 남긴 소켓 파일만 지움 (잘못 지정한 경로의 일반 파일을 지우지 않도록)
+        struct stat existing;
+        if (::lstat(socketPath.c_str(), &existing) == 0) {
+            if (!S_ISSOCK(existing.st_mode)) {
+                std::cerr << "소켓이 아닌 파일이 이미 있습니다: " << socketPath << std::endl;
+                exit(1);
+            }
+            ::unlink(socketPath.c_str());
+        } else if (errno != ENOENT) {
+            std::cerr << "소켓 경로를 확인할 수 없습니다: " << socketPath << " (" << std::strerror(errno) << ")" << std::endl;
+            exit(1);
+        }
+        if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+            ::listen(listenFd, 64) < 0) {
+            std::cerr << "소켓을 열 수 없습니다: " << socketPath << " (" << std::strerror(errno) << ")" << std::endl;
+            exit(1);
+        }
+        std::cout << socketPath << "에서 쿼리를 기다립니다." << std::endl;
 
-    // 오차 계산
-    long long totalErrors = 0;
-    long long totalLength = originalText.length();
+        while (!shutdownRequested) {
+            int fd = ::accept(listenFd, nullptr, nullptr);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            std::lock_guard<std::mutex> lock(connectionMutex);
+            openConnections.push_back(fd);
+            std::thread(&QueryServer::serveConnection, this, fd).detach();
+        }
 
-    for (size_t i = 0; i < totalLength; ++i) {
-        if (originalText[i] != transformedText[i]) {
-            totalErrors++;
+        // 열려 있는 연결의 읽기를 깨우고 모든 연결이 끝날 때까지 대기
+        {
+            std::unique_lock<std::mutex> lock(connectionMutex);
+            for (int fd : openConnections) {
+                ::shutdown(fd, SHUT_RD);
+            }
+            connectionClosed.wait(lock, [&]() { return openConnections.empty(); });
         }
+        ::close(listenFd);
+        ::unlink(socketPath.c_str());
     }
 
-    // 오차율 계산
-    double errorRate = (static_cast<double>(totalErrors) / totalLength) * 100.0;
+private:
+    QueryBatcher batcher;
+    int defaultD;
+    int listenFd = -1;
+    std::atomic<bool> shutdownRequested{false};
 
-    std::cout << "총 오차 개수: " << totalErrors << std::endl;
-    std::cout << "총 문자열 길이: " << totalLength << std::endl;
-    std::cout << std::fixed << std::setprecision(6);
-    std::cout << "최종 오차율: " << errorRate << "%\n";
+    std::mutex connectionMutex;
+    std::condition_variable connectionClosed;
+    std::vector<int> openConnections;   // 열려 있는 클라이언트 소켓 (connectionMutex로 보호)
+
+    /*
+        클라이언트 연결 하나를 처리하는 함수
+        요청은 줄 단위로, "d N"으로 허용 오차를 바꾸고 나머지 줄은 패턴으로 받는다.
+        빈 줄(또는 연결 종료)이 쿼리의 끝이며, 응답은 "패턴\t레코드\t위치" 줄들과 마지막 "END\t매칭수" 줄이다.
+        "shutdown" 줄을 받으면 서버를 종료
+    */
+    void serveConnection(int fd) {
+        std::string buffer;
+        char chunk[4096];
+        bool open = true;
+        int d = defaultD;
+        std::shared_ptr<PatternQuery> query = std::make_shared<PatternQuery>();
+
+        while (open) {
+            ssize_t n = ::read(fd, chunk, sizeof(chunk));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                open = false;
+                buffer += "\n\n"; // 마지막 쿼리 마무리
+            } else {
+                buffer.append(chunk, n);
+            }
+
+            size_t lineEnd;
+            while ((lineEnd = buffer.find('\n')) != std::string::npos) {
+                std::string line = buffer.substr(0, lineEnd);
+                buffer.erase(0, lineEnd + 1);
+                line.erase(std::remove_if(line.begin(), line.end(),
+                                          [](unsigned char c) { return c == '\r'; }), line.end());
+
+                if (line == "shutdown") {
+                    shutdownRequested = true;
+                    ::shutdown(listenFd, SHUT_RDWR);
+                    open = false;
+                    break;
+                }
+                if (line.compare(0, 2, "d ") == 0) {
+                    d = std::max(0, std::atoi(line.c_str() + 2));
+                    continue;
+                }
+                line.erase(std::remove_if(line.begin(), line.end(),
+                                          [](unsigned char c) { return std::isspace(c); }), line.end());
+                if (!line.empty()) {
+                    if (line.find_first_not_of("ACGT") != std::string::npos) {
+                        if (!sendFully(fd, "ERR\t잘못된 패턴: " + line + "\n")) open = false;
+                    } else {
+                        query->patterns.push_back(line);
+                    }
+                    continue;
+                }
+                if (query->patterns.empty()) continue;
+
+                // 쿼리 제출 후 레코드별 결과가 도착하는 대로 전송
+                query->d = d;
+                batcher.submit(query);
+                bool finished = false;
+                while (!finished) {
+                    std::deque<std::string> lines;
+                    {
+                        std::unique_lock<std::mutex> lock(query->mutex);
+                        query->ready.wait(lock, [&]() { return query->done || !query->lines.empty(); });
+                        lines.swap(query->lines);
+                        finished = query->done;
+                    }
+                    std::string out;
+                    for (const std::string& l : lines) {
+                        out += l;
+                        out += '\n';
+                    }
+                    if (finished) out += "END\t" + std::to_string(query->matchCount) + "\n";
+                    if (!out.empty() && !sendFully(fd, out)) open = false;
+                }
+                query = std::make_shared<PatternQuery>();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(connectionMutex);
+        openConnections.erase(std::remove(openConnections.begin(), openConnections.end(), fd), openConnections.end());
+        ::close(fd);
+        connectionClosed.notify_all();
+    }
+};
+
+/*
+    쿼리 서버 모드 (--serve)
+    기준 서열을 한 번만 읽어 메모리에 유지하므로 각 쿼리는 로딩 없이 검색 시간만 든다.
+    @parameters
+    - socketPath: Unix 소켓 경로
+    - inputs: 입력 파일 리스트
+    - defaultD: 기본 허용 오차
+    - cache: 결과 캐시 (사용하지 않으면 nullptr)
+*/
+void runQueryServer(const std::string& socketPath, const std::vector<InputFile>& inputs, int defaultD,
+                    ResultCache* cache) {
+    std::vector<SequenceRecord> records;
+    {
+        ScopedPhase phase("server_load");
+        BoundedQueue<RawBlock> rawBlocks(RAW_QUEUE_CAPACITY);
+        BoundedQueue<SequenceRecord> packedRecords(RECORD_QUEUE_CAPACITY);
+        std::thread loader(loaderStage, std::cref(inputs), std::ref(rawBlocks));
+        std::thread packer(packerStage, std::cref(inputs), std::ref(rawBlocks), std::ref(packedRecords));
+        SequenceRecord record;
+        while (packedRecords.pop(record)) {
+            records.push_back(std::move(record));
+        }
+        loader.join();
+        packer.join();
+    }
+    long long totalLength = 0;
+    for (const SequenceRecord& record : records) {
+        totalLength += record.text.length();
+    }
+    std::cout << "레코드 " << records.size() << "개 (" << totalLength << "bp)를 메모리에 유지합니다." << std::endl;
 
-    return errorRate;
+    QueryServer server(records, defaultD, cache);
+    server.run(socketPath);
 }
 
+/*
+    선별 모드 (--count, --exists, --top N)
+    매칭 위치 목록, SNP 표시, 변환 텍스트와 오차율 계산 없이 패턴별 매칭 수, 존재 여부,
+    또는 (오차 수, 위치)가 가장 작은 N개만 구해 출력한다.
+    EXISTS 모드는 패턴을 한 번 찾으면 남은 작업과 이후 레코드에서 그 패턴을 검색하지 않음
+    @parameters
+    - packedRecords: 패커가 넘겨주는 레코드 큐
+    - root: Aho-Corasick 트라이의 루트 노드
+    - sequences: 검색할 패턴 리스트
+    - d: 허용할 오차 개수
+    - mode: 출력 모드
+*/
+void runScreeningScan(BoundedQueue<SequenceRecord>& packedRecords, TrieNode* root,
+                      const std::vector<std::string>& sequences, int d, const OutputMode& mode) {
+    const size_t MAX_RECORDS_IN_FLIGHT = 3;
+    int maxPatternLength = 0;
+    for (const std::string& pattern : sequences) {
+        maxPatternLength = std::max<int>(maxPatternLength, pattern.length());
+    }
+    std::shared_ptr<std::vector<std::atomic<bool>>> found;
+    if (mode.kind == OutputKind::EXISTS) {
+        found = std::make_shared<std::vector<std::atomic<bool>>>(sequences.size());
+    }
+    std::vector<MatchCollector> totals(sequences.size(), MatchCollector(mode));
+    std::vector<RecordExtent> extents;
+    std::deque<std::pair<SequenceRecord, std::shared_ptr<RecordScanJob>>> inFlight;
+
+    auto completeOldest = [&]() {
+        SequenceRecord& oldest = inFlight.front().first;
+        std::vector<MatchCollector> collected;
+        {
+            ScopedPhase phase("scan_wait", "phase", oldest.name);
+            collected = finishRecordScreen(*inFlight.front().second, sequences.size());
+        }
+        for (size_t i = 0; i < sequences.size(); ++i) {
+            // TOP 모드의 위치를 전역 위치로 바꾸어 합침
+            for (auto& hit : collected[i].best) {
+                hit.second += oldest.offset;
+            }
+            totals[i].merge(std::move(collected[i]));
+        }
+        if (oldest.seamSplit == 0) {
+            extents.push_back(RecordExtent{oldest.name, oldest.offset, oldest.position,
+                                           static_cast<long long>(oldest.text.length())});
+        }
+        inFlight.pop_front();
+    };
+    auto submitRecord = [&](SequenceRecord&& next) {
+        if (inFlight.size() >= MAX_RECORDS_IN_FLIGHT) {
+            completeOldest();
+        }
+        inFlight.emplace_back(std::move(next), nullptr);
+        inFlight.back().second = beginRecordScan(inFlight.back().first, root, sequences, d, nullptr, mode, found);
+    };
+
+    // 이어지는 레코드의 경계에 걸친 매칭은 이음 레코드로 찾음
+    SequenceRecord previousTail;
+    SequenceRecord record;
+    while (packedRecords.pop(record)) {
+        std::cout << "\n레코드 '" << record.name << "' 서열의 길이: " << record.text.length() << std::endl;
+        SequenceRecord seam = makeSeamRecord(previousTail, record, maxPatternLength);
+        previousTail = recordTail(previousTail, record, maxPatternLength - 1);
+        if (!seam.text.empty()) {
+            submitRecord(std::move(seam));
+        }
+        submitRecord(std::move(record));
+    }
+    while (!inFlight.empty()) {
+        completeOldest();
+    }
+
+    // 패턴별 결과 출력
+    ScopedPhase phase("report");
+    for (size_t i = 0; i < sequences.size(); ++i) {
+        const MatchCollector& total = totals[i];
+        std::cout << "\n패턴 " << (i + 1) << ": " << sequences[i] << "\n";
+        if (mode.kind == OutputKind::COUNT) {
+            std::cout << "매칭 수: " << total.count << "\n";
+        } else if (mode.kind == OutputKind::EXISTS) {
+            std::cout << "매칭 여부: " << (total.count > 0 ? "있음" : "없음") << "\n";
+        } else {
+            std::vector<std::pair<int, long long>> best = total.best;
+            std::sort(best.begin(), best.end());
+            std::cout << "상위 매칭:" << (best.empty() ? " 없음" : "") << "\n";
+            for (const auto& hit : best) {
+                // 전역 위치와 염색체 위치, 오차 수
+                std::cout << hit.second;
+                for (const RecordExtent& r : extents) {
+                    if (hit.second >= r.offset && hit.second < r.offset + r.length) {
+                        std::cout << "\t" << r.name << "\t" << (r.position + hit.second - r.offset);
+                        break;
+                    }
+                }
+                std::cout << "\t오차 " << hit.first << "\n";
+            }
+        }
+    }
+}
 
 
-int main() {
-    std::string text;           // 텍스트 문자열
+int main(int argc, char* argv[]) {
     int patternLength;          // 패턴 길이
     int d;                      // 허용 오차 개수
     int numPatterns;            // 생성할 랜덤 패턴의 개수
-    std::string textFileName;   // 텍스트 파일 이름
+    std::vector<InputFile> inputs; // 입력 파일 목록
+    std::string manifestFileName; // 입력 목록 파일 이름 (--manifest)
+    std::string socketPath;     // 쿼리 서버 소켓 경로 (--serve)
+    std::string snpQueryFileName; // 질의할 SNP 색인 파일 (--snp-query)
+    long long densityWindow = 0; // SNP 밀도 트랙의 구간 크기 (--density-window, 0이면 저장하지 않음)
+    std::string panelFileName;  // 패턴 패널 파일 이름 (--panel)
+    std::string cacheDirectory; // 결과 캐시 디렉토리 (--cache-dir)
+    long long cacheSizeMB = 1024; // 결과 캐시 최대 크기 (--cache-size, MB 단위)
+    OutputMode outputMode;      // 출력 모드 (--count, --exists, --top N)
+
+    // 명령행 인자로 여러 파일을 지정할 수 있으며, 없으면 파일 이름을 입력받음
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--panel" && i + 1 < argc) {
+            panelFileName = argv[++i];
+        } else if (arg == "--cache-dir" && i + 1 < argc) {
+            cacheDirectory = argv[++i];
+        } else if (arg == "--cache-size" && i + 1 < argc) {
+            cacheSizeMB = std::stoll(argv[++i]);
+        } else if (arg == "--profile" && i + 1 < argc) {
+            profiler.enable(argv[++i]);
+        } else if (arg == "--manifest" && i + 1 < argc) {
+            manifestFileName = argv[++i];
+        } else if (arg == "--serve" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (arg == "--snp-query" && i + 1 < argc) {
+            snpQueryFileName = argv[++i];
+        } else if (arg == "--density-window" && i + 1 < argc) {
+            densityWindow = std::stoll(argv[++i]);
+        } else if (arg == "--huge-pages") {
+            useHugePages = true;
+        } else if (arg == "--count") {
+            outputMode.kind = OutputKind::COUNT;
+        } else if (arg == "--exists") {
+            outputMode.kind = OutputKind::EXISTS;
+        } else if (arg == "--top" && i + 1 < argc) {
+            outputMode.kind = OutputKind::TOP;
+            outputMode.topN = std::stoll(argv[++i]);
+            if (outputMode.topN <= 0) {
+                std::cerr << "--top에는 1 이상의 개수를 지정해야 합니다." << std::endl;
+                return 1;
+            }
+        } else {
+            InputFile input;
+            input.path = arg;
+            inputs.push_back(input);
+        }
+    }
+    // 저장된 SNP 색인에 대한 질의만 수행
+    if (!snpQueryFileName.empty()) {
+        runSnpQueries(snpQueryFileName);
+        return 0;
+    }
+    if (!manifestFileName.empty()) {
+        std::vector<InputFile> listed = loadManifest(manifestFileName);
+        inputs.insert(inputs.end(), listed.begin(), listed.end());
+    }
+    if (inputs.empty()) {
+        InputFile input;
+        std::cout << "원본 문자열이 포함된 텍스트 파일의 이름을 입력하세요: ";
+        std::cin >> input.path;
+        inputs.push_back(input);
+    }
+
+    // 쿼리 서버 모드에서는 기준 서열만 읽고 소켓으로 패턴을 받음 (기본 허용 오차 0, 쿼리마다 "d N"으로 지정)
+    if (!socketPath.empty()) {
+        std::unique_ptr<ResultCache> cache;
+        if (!cacheDirectory.empty()) {
+            cache.reset(new ResultCache(cacheDirectory, cacheSizeMB << 20));
+        }
+        runQueryServer(socketPath, inputs, 0, cache.get());
+        if (cache) cache->evict();
+        profiler.writeReports();
+        return 0;
+    }
 
-    std::cout << "원본 문자열이 포함된 텍스트 파일의 이름을 입력하세요: ";
-    std::cin >> textFileName;
+    // 파이프라인 큐: 로더 → 패커 → 스캐너 → 결과 기록
+    BoundedQueue<RawBlock> rawBlocks(RAW_QUEUE_CAPACITY);
+    BoundedQueue<SequenceRecord> packedRecords(RECORD_QUEUE_CAPACITY);
+    BoundedQueue<RecordResult> recordResults(RECORD_QUEUE_CAPACITY);
 
-    text = readSequenceFromFile(textFileName);
+    // 로더와 패커는 나머지 입력을 받는 동안 미리 파일을 읽기 시작
+    std::thread loader(loaderStage, std::cref(inputs), std::ref(rawBlocks));
+    std::thread packer(packerStage, std::cref(inputs), std::ref(rawBlocks), std::ref(packedRecords));
 
-    std::cout << "랜덤 패턴의 길이를 입력하세요: ";
-    std::cin >> patternLength;
-    std::cout << "허용되는 오차 개수(d)를 입력하세요: ";
-    std::cin >> d;
-    std::cout << "생성할 랜덤 패턴의 개수: ";
-    std::cin >> numPatterns;
+    // 패널 파일을 사용하면 패턴 길이와 개수는 패널에서 결정
+    std::vector<std::string> panel;
+    if (!panelFileName.empty()) {
+        panel = loadPatternPanel(panelFileName);
+        numPatterns = panel.size();
+        patternLength = 0;
+        for (const std::string& pattern : panel) {
+            patternLength = std::max<int>(patternLength, pattern.length());
+        }
+        std::cout << "허용되는 오차 개수(d)를 입력하세요: ";
+        std::cin >> d;
+    } else {
+        std::cout << "랜덤 패턴의 길이를 입력하세요: ";
+        std::cin >> patternLength;
+        std::cout << "허용되는 오차 개수(d)를 입력하세요: ";
+        std::cin >> d;
+        std::cout << "생성할 랜덤 패턴의 개수: ";
+        std::cin >> numPatterns;
+    }
 
 
     // 전이 행렬 파일 로드 또는 생성
@@ -473,89 +4200,62 @@ int main() {
         // 기본 전이 행렬 사용
     }
 
-    // 패턴 생성
-    std::vector<std::string> sequences = generateRandomDNASequences(transitionProb, patternLength, numPatterns);
+    // 패턴 생성 (패널 파일이 없을 때)
+    std::vector<std::string> sequences =
+        panel.empty() ? generateRandomDNASequences(transitionProb, patternLength, numPatterns) : panel;
 
     // Aho-Corasick 트라이 구축
     TrieNode* root = new TrieNode();
-    for (int i = 0; i < sequences.size(); ++i) {
-        insertPattern(root, sequences[i], i);
-    }
-    buildFailureLinks(root);
-
-    // 전체 작업량 계산 (패턴 수 × 텍스트 길이)
-    total_work = static_cast<long long>(numPatterns) * static_cast<long long>(text.length());
-
-    // SNP 위치를 추적하기 위한 벡터 초기화
-    globalSnpPositions.assign(text.length(), false);
-
-    // 패턴별 매칭 결과 저장할 벡터 초기화
-    std::vector<std::vector<long long>> allPatternMatches(numPatterns, std::vector<long long>());
-
-    // 작업 큐: 각 작업은 (pattern_index, start_pos, end_pos)
-    std::queue<std::tuple<int, long long, long long>> tasks;
-
-    // 텍스트를 청크로 분할하고 작업 큐 초기화
-    const int NUM_CHUNKS = 30;
-    long long text_length = text.length();
-    long long chunk_size = text_length / NUM_CHUNKS;
-    long long overlap = patternLength - 1;
-
     {
-        std::lock_guard<std::mutex> lock(queue_mutex);
-        for (int p = 0; p < numPatterns; ++p) {
-            for (int c = 0; c < NUM_CHUNKS; ++c) {
-                long long start_pos = c * chunk_size;
-                long long end_pos = (c == NUM_CHUNKS - 1) ? text_length : (start_pos + chunk_size + overlap);
-                tasks.emplace(std::make_tuple(p, start_pos, end_pos));
-            }
+        ScopedPhase phase("trie_build");
+        for (int i = 0; i < sequences.size(); ++i) {
+            insertPattern(root, sequences[i], i);
         }
+        buildFailureLinks(root);
     }
 
-    // 스레드 풀 생성 및 작업 처리
-    std::vector<std::thread> threads;
-
-    // 스레드 함수 정의
-    auto worker = [&](int thread_id) {
-        while (true) {
-            std::tuple<int, long long, long long> task;
-            // 작업 큐에서 작업 가져오기
-            {
-                std::unique_lock<std::mutex> lock(queue_mutex);
-                if (tasks.empty()) {
-                    break;
-                }
-                task = tasks.front();
-                tasks.pop();
-            }
-
-            int pattern_idx;
-            long long start_pos, end_pos;
-            std::tie(pattern_idx, start_pos, end_pos) = task;
-
-            std::string pattern = sequences[pattern_idx];
-
-            // 근사 매칭 수행
-            std::vector<long long> matches = aho_corasick_search_approx(text, root, pattern, d, start_pos, end_pos);
-
-            // 매칭 결과 저장
-            if (!matches.empty()) {
-                std::lock_guard<std::mutex> lock(output_mutex);
-                allPatternMatches[pattern_idx].insert(allPatternMatches[pattern_idx].end(), matches.begin(), matches.end());
-            }
+    // 메모리 정리 (트라이 노드 삭제)
+    std::function<void(TrieNode*)> deleteTrie = [&](TrieNode* node) {
+        if (!node) return;
+        for (auto child : node->children) {
+            deleteTrie(child);
         }
+        delete node;
     };
 
-    // 스레드 풀 생성
-    for (unsigned int t = 0; t < NUM_THREADS; ++t) {
-        threads.emplace_back(worker, t);
+    // 선별 모드: 매칭 위치를 모으지 않으므로 결과 기록 단계와 SNP 색인을 사용하지 않음
+    if (outputMode.kind != OutputKind::FULL) {
+        runScreeningScan(packedRecords, root, sequences, d, outputMode);
+        loader.join();
+        packer.join();
+        profiler.writeReports();
+        deleteTrie(root);
+        return 0;
+    }
+
+    // 결과 캐시 열기
+    std::unique_ptr<ResultCache> cache;
+    if (!cacheDirectory.empty()) {
+        cache.reset(new ResultCache(cacheDirectory, cacheSizeMB << 20));
     }
 
+    // 결과 기록 단계 시작
+    std::string outputFileName = "transformed_text.txt";
+    // manifest 모드에서는 염색체 좌표로 된 매칭 목록도 함께 저장
+    std::string matchesFileName = manifestFileName.empty() ? "" : "batch_matches.tsv";
+    WriterSummary summary;
+    std::thread writer(writerStage, std::ref(recordResults), std::cref(sequences), std::cref(transitionProb),
+                       std::cref(outputFileName), std::cref(matchesFileName), std::ref(summary));
+
+    // 패턴별 매칭 결과 저장할 벡터 초기화 (전체 서열 기준 위치)
+    std::vector<std::vector<long long>> allPatternMatches(numPatterns, std::vector<long long>());
+
     // 진행률 모니터링 스레드 추가
+    std::atomic<bool> scan_finished(false);
     std::thread progress_thread([&]() {
-        while (total_processed < total_work) {
-            double progress = (static_cast<double>(total_processed.load()) / total_work) * 100.0;
-            {
+        while (!scan_finished) {
+            if (total_work > 0) {
+                double progress = (static_cast<double>(total_processed.load()) / total_work) * 100.0;
                 std::lock_guard<std::mutex> lock(output_mutex);
                 std::cout << "\r전체 진행률: " << std::fixed << std::setprecision(2) << progress << "% 완료";
                 std::cout.flush();
@@ -569,24 +4269,109 @@ int main() {
         }
     });
 
-    // 모든 스레드가 작업을 완료할 때까지 대기
-    for (auto& th : threads) {
-        th.join();
+    // 스캐너 단계: 패커가 넘겨준 레코드를 공유 워커 풀에 제출하고, 끝난 순서대로 결과를 기록 단계로 넘김
+    // 여러 레코드를 동시에 제출해 작은 파일이 많아도 워커가 놀지 않도록 함
+    // 패널 모드에서는 갱신 시 다시 검색할 수 있도록 레코드를 메모리에 유지
+    const size_t MAX_RECORDS_IN_FLIGHT = 3;
+    std::vector<SequenceRecord> residentRecords;
+    std::vector<RecordExtent> recordExtents;
+    std::deque<std::pair<SequenceRecord, std::shared_ptr<RecordScanJob>>> inFlight;
+
+    auto completeOldest = [&]() {
+        SequenceRecord& oldest = inFlight.front().first;
+        std::vector<std::vector<long long>> matches;
+        {
+            ScopedPhase phase("scan_wait", "phase", oldest.name);
+            matches = finishRecordScan(*inFlight.front().second, cache.get());
+        }
+        for (int i = 0; i < numPatterns; ++i) {
+            for (long long matchIndex : matches[i]) {
+                allPatternMatches[i].push_back(oldest.offset + matchIndex);
+            }
+        }
+
+        if (oldest.seamSplit == 0) {
+            recordExtents.push_back(RecordExtent{oldest.name, oldest.offset, oldest.position,
+                                                 static_cast<long long>(oldest.text.length())});
+            if (!panelFileName.empty()) {
+                residentRecords.push_back(oldest);
+            }
+        }
+        recordResults.push(RecordResult{std::move(oldest), std::move(matches)});
+        inFlight.pop_front();
+    };
+    auto submitRecord = [&](SequenceRecord&& next) {
+        if (inFlight.size() >= MAX_RECORDS_IN_FLIGHT) {
+            completeOldest();
+        }
+        inFlight.emplace_back(std::move(next), nullptr);
+        inFlight.back().second = beginRecordScan(inFlight.back().first, root, sequences, d, cache.get());
+    };
+
+    // 같은 염색체에서 이어지는 레코드는 직전 레코드의 끝부분과 이어 붙여 경계에 걸친 매칭도 찾음
+    SequenceRecord previousTail;
+    SequenceRecord record;
+    while (packedRecords.pop(record)) {
+        long long recordLength = record.text.length();
+        {
+            std::lock_guard<std::mutex> lock(output_mutex);
+            std::cout << "\n레코드 '" << record.name << "' 서열의 길이: " << recordLength << std::endl;
+        }
+
+        // SNP 위치 비트맵을 레코드 길이만큼 확장 (이미 실행 중인 워커에 영향 없음)
+        globalSnpPositions.extend(record.offset + recordLength);
+
+        SequenceRecord seam = makeSeamRecord(previousTail, record, patternLength);
+        previousTail = recordTail(previousTail, record, patternLength - 1);
+        if (!seam.text.empty()) {
+            submitRecord(std::move(seam));
+        }
+        submitRecord(std::move(record));
     }
+    while (!inFlight.empty()) {
+        completeOldest();
+    }
+    recordResults.close();
+    scan_finished = true;
 
-    // 진행률 스레드 종료 대기
     progress_thread.join();
+    loader.join();
+    packer.join();
+    writer.join();
 
-    // 전체 SNP 개수는 중복되지 않은 SNP 위치의 개수
-    long long totalSnps = 0;
-    for (bool snp : globalSnpPositions) {
-        if (snp) totalSnps++;
+    long long textLength = globalSnpPositions.size();
+    if (textLength == 0) {
+        std::cerr << "서열 데이터가 없습니다." << std::endl;
+        exit(1);
     }
+    std::cout << "서열의 길이: " << textLength << std::endl;
+
+    // SNP 비트맵의 rank/select 색인을 구축하여 결과와 함께 저장
+    // 전체 SNP 개수는 중복되지 않은 SNP 위치의 개수
+    std::string snpIndexFileName = "snp_index.bin";
+    SnpRankIndex snpIndex;
+    auto saveSnpIndex = [&]() {
+        {
+            ScopedPhase phase("snp_index");
+            snpIndex.build(globalSnpPositions);
+            if (!snpIndex.save(snpIndexFileName, recordExtents)) {
+                std::cerr << "파일을 생성할 수 없습니다: " << snpIndexFileName << std::endl;
+            }
+        }
+        if (densityWindow > 0) {
+            ScopedPhase phase("snp_density");
+            std::ofstream densityFile("snp_density.tsv");
+            writeSnpDensity(densityFile, snpIndex, recordExtents, densityWindow);
+        }
+    };
+    saveSnpIndex();
+    long long totalSnps = snpIndex.total();
 
     // 오차율 계산
-    double snpPercentage = (static_cast<double>(totalSnps) / text.length()) * 100.0;
+    double snpPercentage = (static_cast<double>(totalSnps) / textLength) * 100.0;
 
     // 패턴별 매칭 인덱스 출력
+    std::unique_ptr<ScopedPhase> reportPhase(new ScopedPhase("report"));
     for (int i = 0; i < numPatterns; ++i) {
         std::cout << "\n패턴 " << (i + 1) << ": " << sequences[i] << "\n매칭 인덱스: ";
         if (allPatternMatches[i].empty()) {
@@ -604,25 +4389,39 @@ int main() {
         std::cout << "패턴 " << i+1 << ": " << sequences[i] <<std::endl;
     }
     std::cout << "\n전체 SNP 개수: " << totalSnps << std::endl;
-    std::cout << "전체 문자열 길이: " << text.length() << std::endl;
+    std::cout << "전체 문자열 길이: " << textLength << std::endl;
     std::cout << std::fixed << std::setprecision(6);
     std::cout << "전체 문자열에 대한 오차율: " << snpPercentage << "%\n";
-    std::string outputFileName = "transformed_text.txt";
-    saveTransformedTextToFile(text, allPatternMatches, sequences, transitionProb, outputFileName);
-    double finalErrorRate = calculateFinalErrorRate(text, outputFileName);
 
-    // 메모리 정리 (트라이 노드 삭제)
-    std::function<void(TrieNode*)> deleteTrie = [&](TrieNode* node) {
-        if (!node) return;
-        for (auto child : node->children) {
-            deleteTrie(child);
-        }
-        delete node;
-    };
+    // 결과 기록 단계에서 집계한 최종 오차율 출력
+    std::cout << "결과 텍스트를 '" << outputFileName << "'에 저장했습니다." << std::endl;
+    std::cout << "SNP 색인을 '" << snpIndexFileName << "'에 저장했습니다." << std::endl;
+    std::cout << "결과 텍스트의 길이: " << summary.totalLength << " 문자\n";
+    double finalErrorRate = (static_cast<double>(summary.totalErrors) / summary.totalLength) * 100.0;
+    std::cout << "총 오차 개수: " << summary.totalErrors << std::endl;
+    std::cout << "총 문자열 길이: " << summary.totalLength << std::endl;
+    std::cout << "최종 오차율: " << finalErrorRate << "%\n";
+    reportPhase.reset();
+
+    // 패널 모드: 패턴 추가/삭제 명령을 받아 증분 갱신
+    if (!panelFileName.empty()) {
+        runPanelUpdates(root, sequences, allPatternMatches, residentRecords, d, cache.get());
+        saveSnpIndex(); // 갱신된 SNP 위치로 색인을 다시 저장
+    }
+
+    // 캐시가 크기 제한을 넘었으면 오래 사용하지 않은 항목부터 삭제
+    if (cache) {
+        std::cout << "캐시 적중: " << cache->hits << ", 캐시 미스: " << cache->misses << std::endl;
+        ScopedPhase phase("cache_evict");
+        cache->evict();
+    }
+
+    // 프로파일 결과 저장 (--profile)
+    profiler.writeReports();
 
     deleteTrie(root);
 
     return 0;
 }
 // 컴파일 명령어:
-// g++ -std=c++17 -pthread -O3 -o aho aho.cpp
+// g++ -std=c++17 -pthread -O3 -o aho aho.cpp -lz   (zlib이 없으면 -lz 없이 빌드, 압축 입력만 지원 안 됨)